@@ -0,0 +1,19 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator: allocations are carved out of large chunks and released
+// all at once by arena_free. Pointers stay valid until then.
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct {
+    ArenaChunk *head;
+} Arena;
+
+void *arena_alloc(Arena *arena, size_t size);
+char *arena_strndup(Arena *arena, const char *s, size_t len);
+void arena_free(Arena *arena);
+
+#endif
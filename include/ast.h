@@ -0,0 +1,77 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stdint.h>
+#include "intern.h"
+
+typedef enum
+{
+    AST_NONE,
+    AST_VAR_DECL,
+    AST_ASSIGNMENT,
+    AST_LITERAL,
+    AST_BINARY_OP,
+    AST_IF_STMT,
+    AST_ELSE_STMT,
+    AST_BLOCK,
+    AST_WHILE_STMT,
+    AST_FOR_STMT,
+    AST_PRE_UPDATE,
+    AST_POST_UPDATE,
+    AST_FUNCTION,
+    AST_IDENTIFIER,
+    AST_LOG_STMT,
+    AST_FUNC_CALL
+} ASTNodeType;
+
+// Nodes are addressed by their index in Ast.nodes. Slot 0 is a zeroed
+// AST_NONE node, so NODE_NONE doubles as "no child" and is always safe to
+// look up.
+typedef uint32_t NodeId;
+#define NODE_NONE 0
+
+// Children of blocks and calls are a contiguous range of Ast.kids.
+// A for loop keeps its init in left and (condition, update, body) as kids.
+typedef struct
+{
+    uint16_t type;     // ASTNodeType
+    uint16_t sem_type; // SemType, filled in by semantic analysis
+    Atom value;        // Variable name, operator, or literal
+    NodeId left;       // LHS (for assignment, binary op)
+    NodeId right;      // RHS (for assignment, binary op)
+    uint32_t first;    // Index of the first child in Ast.kids
+    uint32_t count;    // Number of children
+    uint32_t sym;      // SymbolId of an identifier or declaration, 0 otherwise
+} ASTNode;
+
+typedef struct
+{
+    ASTNode *nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    NodeId *kids;
+    uint32_t kid_count;
+    uint32_t kid_capacity;
+    NodeId root;
+} Ast;
+
+void ast_init(Ast *ast);
+void ast_free(Ast *ast);
+
+// Pointers returned by ast_node are invalidated by the next ast_new
+NodeId ast_new(Ast *ast, ASTNodeType type, Atom value, NodeId left, NodeId right);
+
+// Copy ids to the end of the kids array and make them node's children
+void ast_set_kids(Ast *ast, NodeId node, const NodeId *ids, uint32_t count);
+
+static inline ASTNode *ast_node(const Ast *ast, NodeId id)
+{
+    return &ast->nodes[id];
+}
+
+static inline NodeId ast_kid(const Ast *ast, const ASTNode *node, uint32_t i)
+{
+    return ast->kids[node->first + i];
+}
+
+#endif
@@ -1,20 +1,41 @@
 #ifndef CFG_H
 #define CFG_H
 
-#include "parser.h"
+#include "ir.h"
 
-typedef struct BasicBlock {
+// A basic block is a run of IR instructions [first, end). Edges live in
+// flat arrays indexed by succ_first / pred_first. A conditional block's
+// succs are {fallthrough, jump target}; a jump on a constant keeps
+// only the edge it takes. Edge k of a block is numbered succ_first + k,
+// below 2 * cfg_block_count().
+typedef struct {
     int id;
-    struct BasicBlock **succ;
-    int succ_count;
-    ASTNode **stmts;
-    int stmt_count;
+    int first, end;
+    int succ_first, succ_count;
+    int pred_first, pred_count;
+    int rpo;       // position in reverse postorder, -1 if unreachable
+    int idom;      // immediate dominator, -1 for the entry and unreachable blocks
+    int dom_first, dom_count; // dominator tree children
+    int dom_pre, dom_post;    // dominator tree DFS interval
 } BasicBlock;
 
-void cfg_build(ASTNode *root);
+void cfg_build(IRInstr *ir, int ir_count);
 void cfg_print(void);
 
 BasicBlock *cfg_get_block(int index);
 int cfg_block_count(void);
 
+const int *cfg_succs(const BasicBlock *b);
+const int *cfg_preds(const BasicBlock *b);
+const int *cfg_dom_children(const BasicBlock *b);
+
+// Reachable blocks in reverse postorder; the entry block comes first
+const int *cfg_rpo(int *count);
+
+// Block that starts with the given label
+int cfg_label_block(uint32_t label);
+
+// Does block a dominate block b? O(1) via the dominator tree intervals
+int cfg_dominates(int a, int b);
+
 #endif
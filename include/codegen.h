@@ -3,6 +3,6 @@
 
 #include "parser.h"
 
-void codegen_c(ASTNode *root, const char *out_file);
+void codegen_c(const Ast *ast, const char *out_file);
 
 #endif
@@ -0,0 +1,15 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "ast.h"
+
+// State owned by a single compilation; context_free releases all of it
+// together with the atom table.
+typedef struct {
+    Ast ast;
+} CompileContext;
+
+void context_init(CompileContext *ctx);
+void context_free(CompileContext *ctx);
+
+#endif
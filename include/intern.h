@@ -0,0 +1,29 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Global string interning. Every distinct name is stored once and
+// identified by a 32-bit atom, so name comparisons are integer compares.
+// Atom text is NUL-terminated and stays valid until intern_free.
+
+typedef uint32_t Atom;
+
+enum {
+    ATOM_NONE,
+#define ATOM(name, text) ATOM_##name,
+#include "atoms.def"
+    ATOM_WELL_KNOWN_COUNT
+};
+
+Atom intern(const char *s, size_t len);
+Atom intern_cstr(const char *s);
+
+const char *atom_str(Atom atom);
+size_t atom_len(Atom atom);
+uint32_t atom_count(void);
+
+void intern_free(void);
+
+#endif
@@ -1,29 +1,91 @@
 #ifndef IR_H
 #define IR_H
 #include "parser.h"
+#include "semantic.h"
 
 typedef enum {
-    IR_ASSIGN,
-    IR_BINOP,
-    IR_LABEL,
-    IR_GOTO,
-    IR_IF_FALSE,
-    IR_PARAM,
-    IR_CALL
+    IR_ASSIGN,   // dst = lhs
+    IR_ADD,      // dst = lhs op rhs, IR_ADD .. IR_GE
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_GT,
+    IR_LE,
+    IR_GE,
+    IR_LABEL,    // dst is the label
+    IR_GOTO,     // dst is the target label
+    IR_IF_FALSE, // jump to dst if lhs is zero
+    IR_PARAM,    // lhs is the next call argument
+    IR_CALL,     // call callee with the last argc params
+    IR_NOP,      // deleted instruction
+    IR_PHI,      // dst = phi of argc values, one per CFG predecessor (see ir_phi_args)
+    IR_RET,      // return from main
+    IR_OP_COUNT
 } IROp;
 
+#define IR_IS_BINARY(op) ((op) >= IR_ADD && (op) <= IR_GE)
+
+typedef enum {
+    CALLEE_CONSOLE_LOG
+} IRCallee;
+
+typedef enum {
+    OPD_NONE,
+    OPD_TEMP,  // index: temporary number
+    OPD_VAR,   // index: SymbolId of a variable
+    OPD_INT,   // imm: 32-bit immediate
+    OPD_CONST, // index: entry in the constant pool (int64 / double)
+    OPD_STR,   // index: atom of a string literal
+    OPD_LABEL  // index: label number
+} OperandKind;
+
 typedef struct {
-    IROp op;
-    char *dst;
-    char *lhs;
-    char *op_str;
-    char *rhs;
-    char *label;
-    char *func;
-    int argc;
+    uint32_t kind; // OperandKind
+    union {
+        uint32_t index;
+        int32_t imm;
+    };
+} IROperand;
+
+typedef struct {
+    int is_double;
+    union {
+        int64_t i;
+        double d;
+    };
+} IRConst;
+
+// Three-address instruction, 28 bytes. A phi keeps its arguments in a
+// side pool: lhs.index is the pool offset and rhs the variable it merges.
+typedef struct {
+    uint8_t op;     // IROp
+    uint8_t callee; // IRCallee, for IR_CALL
+    uint16_t argc;  // for IR_CALL
+    IROperand dst;
+    IROperand lhs;
+    IROperand rhs;
 } IRInstr;
 
-void ir_generate(ASTNode *root);
+void ir_generate(const Ast *ast);
+void ir_print(void);
 IRInstr *ir_get_all(int *count);
+const IRConst *ir_const(uint32_t index);
+int ir_temp_count(void);
+int ir_label_count(void);
+
+// Operands an instruction reads (phi arguments excluded); returns how
+// many were stored in uses. ir_def is the operand it writes, or NULL.
+int ir_uses(IRInstr *in, IROperand **uses);
+IROperand *ir_def(IRInstr *in);
+
+// For passes that rewrite the instruction stream
+IROperand ir_new_temp(void);
+IROperand ir_new_label(void);
+IRInstr ir_new_phi(SymbolId var, int argc);
+IROperand *ir_phi_args(const IRInstr *phi);
+void ir_replace(IRInstr *instrs, int count, int capacity); // takes ownership
 
 #endif
@@ -2,8 +2,9 @@
 #define LEXER_H
 
 #include <stdio.h>
-
-#define MAX_TOKEN_LENGTH 256
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
 
 typedef enum {
     TOKEN_IDENTIFIER,
@@ -20,15 +21,62 @@ typedef enum {
     TOKEN_ERROR
 } TokenType;
 
+typedef enum {
+    KW_NONE,
+#define KEYWORD(name, text) KW_##name,
+#include "keywords.def"
+    KW_COUNT
+} Keyword;
+
+typedef enum {
+    BUILTIN_NONE,
+#define BUILTIN(name, text) BUILTIN_##name,
+#include "keywords.def"
+    BUILTIN_COUNT
+} BuiltinObject;
+
+// A token is a span into the lexer's source buffer; no text is copied.
+// String literals span their contents without the surrounding quotes.
+// atom is the interned span text (ATOM_NONE for EOF). type holds a
+// TokenType and kw a Keyword (KW_NONE for non-keywords).
 typedef struct {
-    TokenType type;
-    char lexeme[MAX_TOKEN_LENGTH];
+    uint32_t offset;
+    uint32_t length;
+    Atom atom;
+    uint16_t type;
+    uint16_t kw;
     int line;
 } Token;
 
-int is_builtInObject(const char *str);
-int is_keyword(const char *str);
-Token get_next_token(FILE *file);
+typedef struct {
+    const char *src;
+    size_t len;
+    size_t pos;
+    int line;
+    int mapped; // src is an mmap of the input file
+    int owned;  // src was read into a malloc'd buffer
+    int defer_atoms; // leave Token.atom unset; the consumer interns it
+} Lexer;
+
+// Lex a caller-owned buffer; it must outlive every token produced from it.
+void lexer_init(Lexer *lexer, const char *src, size_t len);
+
+// Memory-map a source file (falls back to reading it for non-regular files).
+// Returns 0 on success, -1 on failure with errno set.
+int lexer_open(Lexer *lexer, const char *path);
+void lexer_close(Lexer *lexer);
+
+Token lexer_next(Lexer *lexer);
+
+static inline const char *token_text(const char *src, Token token)
+{
+    return src + token.offset;
+}
+
+// Both are a single perfect-hash probe (see tools/kwgen.c)
+BuiltinObject is_builtInObject(const char *str, size_t len);
+Keyword is_keyword(const char *str, size_t len);
+const char *keyword_text(Keyword kw);
 
 
 #endif // LEXER_H
\ No newline at end of file
@@ -4,9 +4,55 @@
 #include "parser.h"
 #include "cfg.h"
 
-void opt_constant_folding(void);
-void opt_dead_code_elimination(void);
+typedef struct {
+    int unreachable_blocks;
+    int dead_instrs;
+    int dead_stores; // writes to memory variables nobody reads
+} DceStats;
 
-ASTNode *opt_fold_constants(ASTNode *node);
+typedef struct {
+    int redundant; // expressions already computed in a dominating block
+    int copies;    // copies and single-valued phis folded into their source
+} GvnStats;
+
+typedef struct {
+    int loops;
+    int hoisted; // invariant instructions moved to a preheader
+    int reduced; // counter multiplications turned into additions
+} LoopStats;
+
+typedef struct {
+    int full;    // counted loops replaced by straight-line copies
+    int partial; // counted loops unrolled by the factor
+} UnrollStats;
+
+// Sparse liveness over the reachable blocks (src/opt/liveness.c).
+// name_of numbers the operands to track and gives -1 for the rest;
+// blocks[first[n] .. first[n + 1]) are the blocks name n is live into.
+typedef struct {
+    int *first;
+    int *blocks;
+} Liveness;
+
+void liveness_build(Liveness *live, int names, int (*name_of)(IROperand v));
+void liveness_free(Liveness *live);
+
+// Removes unreachable code, values no effect depends on (marked from
+// the roots with a worklist) and variable stores no path reads before
+// the next store. Keeps the CFG shape, so no rebuild is needed.
+void opt_dead_code_elimination(DceStats *stats);
+
+// Sparse conditional constant propagation on the SSA form (src/opt/sccp.c)
+void opt_sccp(void);
+
+// Dominator-scoped value numbering and CSE (src/opt/gvn.c)
+void opt_gvn(GvnStats *stats);
+
+// Natural loops, LICM and induction-variable strength reduction (src/opt/loop.c)
+void opt_loops(LoopStats *stats);
+
+// Unrolls counted loops with a constant trip count: small ones fully,
+// larger ones `factor` times with the remainder peeled in front
+void opt_unroll(int factor, UnrollStats *stats);
 
 #endif
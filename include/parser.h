@@ -3,6 +3,9 @@
 
 #include <stdio.h>
 #include "lexer.h"
+#include "token_stream.h"
+#include "intern.h"
+#include "ast.h"
 
 // typedef enum {
 //     TOKEN_IDENTIFIER,
@@ -27,35 +30,6 @@
 // } Token;
 
 
-typedef enum
-{
-    AST_VAR_DECL,
-    AST_ASSIGNMENT,
-    AST_LITERAL,
-    AST_BINARY_OP,
-    AST_IF_STMT,
-    AST_ELSE_STMT,
-    AST_BLOCK,
-    AST_WHILE_STMT,
-    AST_FOR_STMT,
-    AST_PRE_UPDATE,
-    AST_POST_UPDATE,
-    AST_FUNCTION,
-    AST_IDENTIFIER,
-    AST_LOG_STMT,
-    AST_FUNC_CALL
-} ASTNodeType;
-
-typedef struct ASTNode
-{
-    ASTNodeType type;
-    char *value;           // Variable name, operator, or literal
-    struct ASTNode *left;  // LHS (for assignment, binary op)
-    struct ASTNode *right; // RHS (for assignment, binary op)
-    struct ASTNode **body; // For block statements
-    int body_size;
-} ASTNode;
-
 #define PARSER_MAX_SYMBOLS 100
 
 typedef struct
@@ -69,12 +43,14 @@ typedef struct
 
 // extern Symbol symbolTable[MAX_SYMBOLS];
 
-void free_ast(ASTNode *node);
-void print_ast(ASTNode *node, int depth);
+void print_ast(const Ast *ast, NodeId node, int depth);
 void printSymbolTable();
 void generate_tac(ASTNode *node);
-ASTNode *parse_statement(Token tokens[], int *index);
-ASTNode *create_node(ASTNodeType type, char *value);
+
+// Nodes are appended to ast; parse_program also sets ast->root.
+void parser_init(Ast *ast);
+NodeId parse_statement(TokenStream *ts);
+NodeId parse_program(TokenStream *ts);
 // Token get_next_token(FILE *file); // This function must be implemented by you in parser.c or another file
 
 #endif // PARSER_H
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef PASS_H
+#define PASS_H
+
+// Pass manager for everything between CFG construction and codegen.
+// Passes run in a fixed order; a level picks the default set, -fpass=
+// overrides adjust it, and each pass pulls in the passes it requires.
+
+typedef enum {
+    PASS_CFG, // rewrites the CFG (rebuilds it)
+    PASS_IR   // rewrites instructions, keeps the CFG shape
+} PassKind;
+
+// -O0: no optimization, -O1: SSA, SCCP and DCE, -O2: everything
+void pass_set_level(int level);
+
+// Comma-separated pass names, each optionally prefixed with "no-"
+void pass_override(const char *list);
+
+void pass_set_unroll(int factor);
+
+// Run the selected passes on the current IR and CFG. time_passes reports
+// wall time and peak RSS growth per pass; pass_stats reports instruction
+// counts and what each pass changed.
+void pass_run_all(int time_passes, int pass_stats);
+
+#endif
@@ -1,8 +1,13 @@
 #ifndef QBE_CODEGEN_H
 #define QBE_CODEGEN_H
 
+#include <stdio.h>
 #include "ir.h"
+#include "cfg.h"
 
-void qbe_codegen_ir(IRInstr *ir, int ir_count, const char *out_qbe);
+// Emits the blocks of the CFG last built over ir by cfg_build. The IR may
+// be in SSA form; phis map directly onto QBE phis. Writes the IL to
+// stream, which may be a file or an in-memory stream.
+void qbe_codegen_ir(IRInstr *ir, FILE *stream);
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+// Byte-scanning kernels used by the lexer's hot loops. Each one starts at
+// pos, never reads at or past len, and returns the index of the first byte
+// that stops the scan (len if none does). Newlines stepped over are added
+// to *lines.
+
+// Pick the widest kernels the CPU supports (AVX2, SSE2 or scalar).
+// Safe to call more than once.
+void scan_init(void);
+const char *scan_kernel_name(void);
+
+// Skip whitespace (isspace in the C locale)
+size_t scan_space(const char *src, size_t pos, size_t len, int *lines);
+
+// Skip identifier characters [A-Za-z0-9_]
+size_t scan_ident(const char *src, size_t pos, size_t len);
+
+// Find the next byte that appears in stops (1 to 4 bytes, NUL-terminated).
+// A newline listed in stops is not counted.
+size_t scan_until(const char *src, size_t pos, size_t len, const char *stops, int *lines);
+
+#endif
@@ -10,10 +10,25 @@ typedef enum {
     TYPE_UNKNOWN
 } SemType;
 
-SemType semantic_get_type(const char *name);
+// Every declaration gets a SymbolId that stays valid after analysis.
+// 0 is never a symbol.
+typedef uint32_t SymbolId;
+#define SYMBOL_NONE 0
 
+typedef struct {
+    Atom name;
+    int is_const;
+    int depth; // scope depth of the declaration, 0 is the global scope
+    SemType type;
+} SemanticSymbol;
 
-// Entry point for semantic analysis
-void semantic_analyze(ASTNode *root);
+const SemanticSymbol *semantic_symbol(SymbolId id);
+uint32_t semantic_symbol_count(void);
+
+
+// Entry point for semantic analysis. Binds every identifier and
+// declaration node to its SymbolId (ASTNode.sym) and records the
+// expression types it infers in ASTNode.sem_type.
+void semantic_analyze(Ast *ast);
 
 #endif
@@ -0,0 +1,21 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include "ir.h"
+#include "cfg.h"
+
+// Variables SSA construction turns into temporaries (strings stay in memory)
+int ssa_promotable(SymbolId var);
+
+// Rewrite the IR into SSA form: phis on the iterated dominance frontier
+// of each variable's definitions (semi-pruned), then renaming along the
+// dominator tree. Every promotable variable becomes single-assignment
+// temporaries. Rebuilds the CFG.
+void ssa_construct(void);
+
+// Replace phis with copies on the incoming edges, splitting critical
+// edges. Temporaries may be assigned more than once afterwards. Rebuilds
+// the CFG. For backends without phis; QBE takes SSA directly.
+void ssa_destruct(void);
+
+#endif
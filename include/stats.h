@@ -0,0 +1,31 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+// Compile-time instrumentation. Phases nest; each records wall time
+// (monotonic clock), heap allocations made while it was open and peak
+// RSS. External tools run through stats_exec get their own child RSS.
+// Timers are no-ops until stats_enable is called.
+
+void stats_enable(void);
+void stats_begin(const char *name);
+void stats_end(void);
+
+// Run argv[0] (searched in PATH) as a timed phase and wait for it.
+// Returns its exit status, 128 + the signal number if a signal killed
+// it, or -1 if it could not be started.
+int stats_exec(const char *name, char *const argv[]);
+
+// Same, with in (if not NULL) as the tool's stdin and its stdout
+// collected into a malloc'd *out (if out is not NULL)
+int stats_exec_io(const char *name, char *const argv[], const char *in, size_t in_len,
+                  char **out, size_t *out_len);
+
+// Human-readable table of every phase, indented by nesting
+void stats_report(FILE *out);
+
+// Chrome trace_event JSON (chrome://tracing, Perfetto). Returns 0 on success.
+int stats_write_trace(const char *path);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+
+#include <pthread.h>
+#include "lexer.h"
+
+// Tokens flow from the lexer to the parser on demand through a small ring
+// buffer, so the full token array is never materialized. The parser may
+// look at most TS_LOOKAHEAD tokens ahead of the current one.
+//
+// With token_stream_start_thread the lexer runs on a producer thread and
+// hands tokens over a lock-free single-producer/single-consumer queue.
+// Interning stays on the consumer side since the atom table is not
+// thread-safe.
+
+#define TS_LOOKAHEAD 4
+#define TS_RING_SIZE 8 // power of two, larger than TS_LOOKAHEAD
+
+// Called once for every token the lexer produces (EOF included), on
+// whichever thread runs the lexer
+typedef void (*TokenObserver)(const Token *token, const char *src, void *data);
+
+typedef struct SpscQueue SpscQueue;
+
+typedef struct {
+    Lexer *lexer;
+    Token ring[TS_RING_SIZE];
+    unsigned head;  // ring index of the current token
+    unsigned count; // tokens buffered from head
+    int at_eof;     // EOF has been pulled from the lexer
+    Token eof;
+    TokenObserver observer;
+    void *observer_data;
+
+    SpscQueue *queue; // non-NULL while the producer thread runs
+    pthread_t producer;
+} TokenStream;
+
+void token_stream_init(TokenStream *ts, Lexer *lexer, TokenObserver observer, void *data);
+
+// Move lexing to a producer thread. Returns 0 on success; on failure the
+// stream keeps lexing inline.
+int token_stream_start_thread(TokenStream *ts);
+
+// Lex (and observe) whatever the parser did not consume
+void token_stream_drain(TokenStream *ts);
+
+// Drains the stream, joins the producer thread and frees the queue
+void token_stream_close(TokenStream *ts);
+
+Token token_stream_fill(TokenStream *ts, unsigned k);
+
+// Token k places after the current one; EOF repeats past the end
+static inline Token peek_token(TokenStream *ts, unsigned k)
+{
+    if (k < ts->count)
+        return ts->ring[(ts->head + k) & (TS_RING_SIZE - 1)];
+    return token_stream_fill(ts, k);
+}
+
+static inline void advance_token(TokenStream *ts)
+{
+    if (!ts->count)
+        token_stream_fill(ts, 0);
+    ts->head = (ts->head + 1) & (TS_RING_SIZE - 1);
+    ts->count--;
+}
+
+#endif
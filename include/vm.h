@@ -0,0 +1,59 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+#include "ir.h"
+
+// Register bytecode interpreter. Every operand is a frame slot:
+// temporaries first, then variables, then one slot per immediate,
+// preloaded. Values are 32-bit words, as on the native paths. A branch
+// on a compare used nowhere else becomes one compare-and-branch.
+
+typedef enum {
+    VM_MOV,     // a = b
+    VM_ADD,     // a = b op c, VM_ADD .. VM_GE in IR order
+    VM_SUB,
+    VM_MUL,
+    VM_DIV,
+    VM_EQ,
+    VM_NE,
+    VM_LT,
+    VM_GT,
+    VM_LE,
+    VM_GE,
+    VM_JMP,     // pc = a
+    VM_JZ,      // if b == 0: pc = a
+    VM_JEQ,     // if b op c: pc = a, VM_JEQ .. VM_JGE
+    VM_JNE,
+    VM_JLT,
+    VM_JGT,
+    VM_JLE,
+    VM_JGE,
+    VM_PRINT,   // print a
+    VM_RET,
+    VM_OP_COUNT
+} VMOp;
+
+typedef struct {
+    uint32_t op; // VMOp
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+} VMInstr;
+
+typedef struct {
+    VMInstr *code;
+    int count;
+    int32_t *slots; // initial frame: zeros, then the immediates
+    int slot_count;
+} VMProgram;
+
+// Lower the current IR; phis must already be gone (ssa_destruct)
+void vm_compile(VMProgram *prog);
+void vm_print(const VMProgram *prog);
+void vm_free(VMProgram *prog);
+
+// Run to the end of main; returns the exit status (1 on a runtime error)
+int vm_run(const VMProgram *prog);
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef X86_H
+#define X86_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ir.h"
+#include "cfg.h"
+
+// Native x86-64 backend: linear-scan register allocation over the CFG,
+// direct instruction encoding and a static ELF executable with a small
+// built-in runtime (buffered integer printing over the write syscall).
+// No assembler or linker is involved.
+
+// Machine code plus a zero-initialized data area placed data_offset
+// bytes after the start of the code (page aligned, so the code can reach
+// it RIP-relative wherever the two are mapped together)
+typedef struct {
+    uint8_t *code;
+    size_t code_len;
+    size_t data_offset;
+    size_t data_size;
+    size_t main_offset;  // int main(void), SysV calling convention
+    size_t start_offset; // process entry: runs main, then exits
+} X86Image;
+
+// Compile the current IR and CFG; phis must already be gone (ssa_destruct)
+void x86_codegen(X86Image *image);
+void x86_free(X86Image *image);
+
+// Static ET_EXEC for Linux x86-64, written with mode 0755
+int x86_write_elf(const X86Image *image, const char *path);
+
+// Map the image into executable memory and call main in-process;
+// returns -1 if the memory could not be set up
+int x86_jit_run(const X86Image *image, int *status);
+
+/* ---------- Encoder (src/x86/encode.c) ---------- */
+
+typedef enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+} X86Reg;
+
+typedef enum {
+    X86_RM_REG,  // register
+    X86_RM_MEM,  // [reg + disp]
+    X86_RM_DATA  // [rip + data area offset disp]
+} X86RmKind;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t reg;
+    int32_t disp;
+} X86Rm;
+
+// Condition codes as used by jcc / setcc
+typedef enum {
+    CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF,
+    CC_S = 0x8, CC_NS = 0x9
+} X86Cond;
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    int *labels; // code offset per label, -1 until bound
+    int label_count;
+    int label_cap;
+    struct X86Fixup *fixups;
+    int fixup_count;
+    int fixup_cap;
+} X86Asm;
+
+static inline X86Rm x86_reg(X86Reg r)
+{
+    return (X86Rm){X86_RM_REG, r, 0};
+}
+
+static inline X86Rm x86_mem(X86Reg base, int32_t disp)
+{
+    return (X86Rm){X86_RM_MEM, base, disp};
+}
+
+static inline X86Rm x86_data(int32_t offset)
+{
+    return (X86Rm){X86_RM_DATA, 0, offset};
+}
+
+void x86_asm_init(X86Asm *a);
+void x86_asm_free(X86Asm *a);
+void x86_byte(X86Asm *a, uint8_t b);
+void x86_imm32(X86Asm *a, int32_t v);
+
+// One instruction with a ModRM operand: optional REX, opcode bytes, ModRM,
+// SIB and displacement. opcode is a byte string (no zero bytes).
+// width is 8, 32 or 64; reg is the ModRM reg field
+// (a register or an opcode extension). imm_size is the number of
+// immediate bytes the caller appends afterwards (needed for RIP-relative
+// displacements).
+void x86_modrm(X86Asm *a, int width, const char *opcode, int reg, X86Rm rm, int imm_size);
+
+int x86_new_label(X86Asm *a);
+void x86_bind(X86Asm *a, int label);
+void x86_jmp(X86Asm *a, int label);
+void x86_jcc(X86Asm *a, X86Cond cc, int label);
+void x86_call(X86Asm *a, int label);
+void x86_push(X86Asm *a, X86Reg r);
+void x86_pop(X86Asm *a, X86Reg r);
+
+// Patch branches and data references once the data offset is known
+void x86_resolve(X86Asm *a, size_t data_offset);
+
+/* ---------- Register allocation (src/x86/regalloc.c) ---------- */
+
+// Location of a temporary: a register, or a spill slot at [rbp + disp]
+typedef struct {
+    int8_t reg; // X86Reg, or -1 when spilled
+    int32_t disp;
+} X86Loc;
+
+// Linear scan over live intervals built from per-temporary live ranges
+// and the block layout order. frame_size grows by the spill slots it
+// hands out.
+X86Loc *x86_regalloc(const int *layout, int layout_count, int *frame_size,
+                     unsigned *used_regs);
+
+#endif
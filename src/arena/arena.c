@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/arena.h"
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t used;
+    size_t size;
+    _Alignas(ARENA_ALIGN) unsigned char data[];
+};
+
+static ArenaChunk *new_chunk(size_t min_size)
+{
+    size_t size = min_size > ARENA_CHUNK_SIZE ? min_size : ARENA_CHUNK_SIZE;
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + size);
+    if (!chunk) {
+        perror("malloc");
+        exit(1);
+    }
+    chunk->next = NULL;
+    chunk->used = 0;
+    chunk->size = size;
+    return chunk;
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk *chunk = arena->head;
+    if (chunk && size > ARENA_CHUNK_SIZE / 4) {
+        // Large blocks get their own chunk behind the current one so its
+        // free space is not abandoned
+        ArenaChunk *big = new_chunk(size);
+        big->used = size;
+        big->next = chunk->next;
+        chunk->next = big;
+        return big->data;
+    }
+    if (!chunk || chunk->size - chunk->used < size) {
+        chunk = new_chunk(size);
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+
+    void *p = chunk->data + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+char *arena_strndup(Arena *arena, const char *s, size_t len)
+{
+    char *copy = arena_alloc(arena, len + 1);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+void arena_free(Arena *arena)
+{
+    ArenaChunk *chunk = arena->head;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+}
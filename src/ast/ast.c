@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/ast.h"
+
+static void *grow(void *p, uint32_t *capacity, uint32_t needed, size_t elem)
+{
+    if (needed <= *capacity)
+        return p;
+    uint32_t cap = *capacity ? *capacity : 256;
+    while (cap < needed)
+        cap *= 2;
+    p = realloc(p, elem * cap);
+    if (!p) {
+        perror("realloc");
+        exit(1);
+    }
+    *capacity = cap;
+    return p;
+}
+
+void ast_init(Ast *ast)
+{
+    memset(ast, 0, sizeof(*ast));
+    ast->nodes = grow(NULL, &ast->node_capacity, 1, sizeof(ASTNode));
+    memset(&ast->nodes[NODE_NONE], 0, sizeof(ASTNode));
+    ast->node_count = 1;
+}
+
+void ast_free(Ast *ast)
+{
+    free(ast->nodes);
+    free(ast->kids);
+    memset(ast, 0, sizeof(*ast));
+}
+
+NodeId ast_new(Ast *ast, ASTNodeType type, Atom value, NodeId left, NodeId right)
+{
+    ast->nodes = grow(ast->nodes, &ast->node_capacity, ast->node_count + 1, sizeof(ASTNode));
+    NodeId id = ast->node_count++;
+    ast->nodes[id] = (ASTNode){
+        .type = type,
+        .value = value,
+        .left = left,
+        .right = right};
+    return id;
+}
+
+void ast_set_kids(Ast *ast, NodeId node, const NodeId *ids, uint32_t count)
+{
+    ast->kids = grow(ast->kids, &ast->kid_capacity, ast->kid_count + count, sizeof(NodeId));
+    memcpy(ast->kids + ast->kid_count, ids, sizeof(NodeId) * count);
+    ast->nodes[node].first = ast->kid_count;
+    ast->nodes[node].count = count;
+    ast->kid_count += count;
+}
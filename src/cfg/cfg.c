@@ -2,97 +2,293 @@
 #include <stdlib.h>
 #include "../include/cfg.h"
 
-#define MAX_BLOCKS 128
-
-static BasicBlock *blocks[MAX_BLOCKS];
+static BasicBlock *blocks;
 static int block_count = 0;
+static int block_capacity = 0;
+
+static int *succs;     // 2 slots per block
+static int *preds;
+static int *dom_kids;
+static int *rpo;
+static int rpo_count = 0;
+static int *label_block;
+static int label_capacity = 0;
+static int edge_capacity = 0;
+
+static void *grow(void *p, size_t size) {
+    p = realloc(p, size);
+    if (!p && size) {
+        perror("realloc");
+        exit(1);
+    }
+    return p;
+}
 
-static BasicBlock *new_block() {
-    BasicBlock *b = malloc(sizeof(BasicBlock));
-    b->id = block_count;
-    b->succ = NULL;
-    b->succ_count = 0;
-    b->stmts = NULL;
-    b->stmt_count = 0;
-    blocks[block_count++] = b;
+static BasicBlock *new_block(int first) {
+    if (block_count >= block_capacity) {
+        block_capacity = block_capacity ? block_capacity * 2 : 128;
+        blocks = grow(blocks, sizeof(BasicBlock) * block_capacity);
+    }
+    BasicBlock *b = &blocks[block_count];
+    *b = (BasicBlock){.id = block_count, .first = first, .end = first, .rpo = -1, .idom = -1};
+    block_count++;
     return b;
 }
 
-static void add_edge(BasicBlock *from, BasicBlock *to) {
-    from->succ = realloc(from->succ,
-        sizeof(BasicBlock*) * (from->succ_count + 1));
-    from->succ[from->succ_count++] = to;
+static int ends_block(const IRInstr *in) {
+    return in->op == IR_GOTO || in->op == IR_IF_FALSE || in->op == IR_RET;
+}
+
+/* ---------- Blocks and edges ---------- */
+
+static void split_blocks(IRInstr *ir, int ir_count) {
+    int labels = ir_label_count();
+    if (labels > label_capacity) {
+        label_capacity = labels;
+        label_block = grow(label_block, sizeof(int) * label_capacity);
+    }
+
+    // The entry block never has predecessors, so a leading label (a loop
+    // at the top of the program) gets a block of its own
+    BasicBlock *b = new_block(0);
+    for (int i = 0; i < ir_count; i++) {
+        if (ir[i].op == IR_LABEL && (b->end > b->first || b->id == 0))
+            b = new_block(i);
+        if (ir[i].op == IR_LABEL)
+            label_block[ir[i].dst.index] = b->id;
+        b->end = i + 1;
+        if (ends_block(&ir[i]) && i + 1 < ir_count)
+            b = new_block(i + 1);
+    }
 }
 
-static BasicBlock *build_from_node(ASTNode *node, BasicBlock *curr) {
-    if (!node) return curr;
+static void add_succ(BasicBlock *b, int to) {
+    for (int i = 0; i < b->succ_count; i++)
+        if (succs[b->succ_first + i] == to)
+            return;
+    succs[b->succ_first + b->succ_count++] = to;
+}
 
-    switch (node->type) {
+static void link_blocks(IRInstr *ir) {
+    if (block_count * 2 > edge_capacity) {
+        edge_capacity = block_count * 2;
+        succs = grow(succs, sizeof(int) * edge_capacity);
+        preds = grow(preds, sizeof(int) * edge_capacity);
+    }
 
-    case AST_BLOCK:
-        for (int i = 0; i < node->body_size; i++)
-            curr = build_from_node(node->body[i], curr);
-        return curr;
+    for (int i = 0; i < block_count; i++) {
+        BasicBlock *b = &blocks[i];
+        b->succ_first = i * 2;
+        const IRInstr *last = b->end > b->first ? &ir[b->end - 1] : NULL;
 
-    case AST_IF_STMT: {
-        BasicBlock *thenB = new_block();
-        BasicBlock *after = new_block();
+        if (last && last->op == IR_GOTO) {
+            add_succ(b, label_block[last->dst.index]);
+            continue;
+        }
+        if (last && last->op == IR_RET)
+            continue;
+        if (last && last->op == IR_IF_FALSE && last->lhs.kind == OPD_INT) {
+            add_succ(b, last->lhs.imm ? i + 1 : label_block[last->dst.index]);
+            continue;
+        }
+        if (i + 1 < block_count)
+            add_succ(b, i + 1);
+        if (last && last->op == IR_IF_FALSE)
+            add_succ(b, label_block[last->dst.index]);
+    }
 
-        add_edge(curr, thenB);
-        add_edge(curr, after);
+    // Predecessors: count, prefix sum, fill
+    for (int i = 0; i < block_count; i++)
+        for (int j = 0; j < blocks[i].succ_count; j++)
+            blocks[succs[blocks[i].succ_first + j]].pred_count++;
 
-        BasicBlock *endThen = build_from_node(node->right, thenB);
-        add_edge(endThen, after);
+    int offset = 0;
+    for (int i = 0; i < block_count; i++) {
+        blocks[i].pred_first = offset;
+        offset += blocks[i].pred_count;
+        blocks[i].pred_count = 0;
+    }
 
-        return after;
+    for (int i = 0; i < block_count; i++) {
+        for (int j = 0; j < blocks[i].succ_count; j++) {
+            BasicBlock *s = &blocks[succs[blocks[i].succ_first + j]];
+            preds[s->pred_first + s->pred_count++] = i;
+        }
     }
+}
 
-    case AST_WHILE_STMT: {
-        BasicBlock *cond = new_block();
-        BasicBlock *body = new_block();
-        BasicBlock *after = new_block();
+/* ---------- Reverse postorder ---------- */
 
-        add_edge(curr, cond);
-        add_edge(cond, body);
-        add_edge(cond, after);
+// Iterative DFS; next[] is how many successors of a block were visited
+static void compute_rpo(void) {
+    rpo = grow(rpo, sizeof(int) * block_count);
+    int *stack = malloc(sizeof(int) * block_count);
+    int *next = calloc(block_count, sizeof(int));
+    char *seen = calloc(block_count, 1);
+    int top = 0;
+    int post = block_count;
 
-        BasicBlock *endBody = build_from_node(node->right, body);
-        add_edge(endBody, cond);
+    stack[top++] = 0;
+    seen[0] = 1;
+    while (top) {
+        BasicBlock *b = &blocks[stack[top - 1]];
+        if (next[b->id] < b->succ_count) {
+            int s = succs[b->succ_first + next[b->id]++];
+            if (!seen[s]) {
+                seen[s] = 1;
+                stack[top++] = s;
+            }
+            continue;
+        }
+        rpo[--post] = b->id;
+        top--;
+    }
 
-        return after;
+    // Unreachable blocks never got a slot; shift the order to the front
+    rpo_count = block_count - post;
+    for (int i = 0; i < rpo_count; i++) {
+        rpo[i] = rpo[post + i];
+        blocks[rpo[i]].rpo = i;
     }
 
-    default:
-        curr->stmts = realloc(curr->stmts,
-            sizeof(ASTNode*) * (curr->stmt_count + 1));
-        curr->stmts[curr->stmt_count++] = node;
-        return curr;
+    free(stack);
+    free(next);
+    free(seen);
+}
+
+/* ---------- Dominators ---------- */
+
+// Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"
+static int intersect(int a, int b) {
+    while (a != b) {
+        while (blocks[a].rpo > blocks[b].rpo)
+            a = blocks[a].idom;
+        while (blocks[b].rpo > blocks[a].rpo)
+            b = blocks[b].idom;
     }
+    return a;
 }
 
-void cfg_build(ASTNode *root) {
+static void compute_dominators(void) {
+    blocks[0].idom = 0;
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < rpo_count; i++) {
+            BasicBlock *b = &blocks[rpo[i]];
+            int idom = -1;
+            for (int j = 0; j < b->pred_count; j++) {
+                int p = preds[b->pred_first + j];
+                if (blocks[p].idom < 0)
+                    continue; // unreachable or not processed yet
+                idom = idom < 0 ? p : intersect(p, idom);
+            }
+            if (idom != b->idom) {
+                b->idom = idom;
+                changed = 1;
+            }
+        }
+    }
+    blocks[0].idom = -1;
+
+    // Dominator tree children, grouped by parent
+    dom_kids = grow(dom_kids, sizeof(int) * block_count);
+    for (int i = 1; i < rpo_count; i++)
+        blocks[blocks[rpo[i]].idom].dom_count++;
+
+    int offset = 0;
+    for (int i = 0; i < block_count; i++) {
+        blocks[i].dom_first = offset;
+        offset += blocks[i].dom_count;
+        blocks[i].dom_count = 0;
+    }
+    for (int i = 1; i < rpo_count; i++) {
+        BasicBlock *parent = &blocks[blocks[rpo[i]].idom];
+        dom_kids[parent->dom_first + parent->dom_count++] = rpo[i];
+    }
+
+    // Pre/post numbering for constant-time dominance queries
+    int *stack = malloc(sizeof(int) * block_count);
+    int *next = calloc(block_count, sizeof(int));
+    int top = 0, clock = 0;
+    stack[top++] = 0;
+    blocks[0].dom_pre = clock++;
+    while (top) {
+        BasicBlock *b = &blocks[stack[top - 1]];
+        if (next[b->id] < b->dom_count) {
+            int kid = dom_kids[b->dom_first + next[b->id]++];
+            blocks[kid].dom_pre = clock++;
+            stack[top++] = kid;
+            continue;
+        }
+        b->dom_post = clock++;
+        top--;
+    }
+    free(stack);
+    free(next);
+}
+
+/* ---------- Public API ---------- */
+
+void cfg_build(IRInstr *ir, int ir_count) {
     block_count = 0;
-    BasicBlock *entry = new_block();
-    build_from_node(root, entry);
+    split_blocks(ir, ir_count);
+    link_blocks(ir);
+    compute_rpo();
+    compute_dominators();
 }
 
-void cfg_print() {
+void cfg_print(void) {
     for (int i = 0; i < block_count; i++) {
-        BasicBlock *b = blocks[i];
-        printf("Block B%d:\n", b->id);
-        printf("  Statements: %d\n", b->stmt_count);
-        printf("  Successors:");
+        BasicBlock *b = &blocks[i];
+        printf("Block B%d: [%d, %d)", b->id, b->first, b->end);
+        if (b->rpo < 0)
+            printf(" unreachable");
+        else if (b->idom >= 0)
+            printf(" idom B%d", b->idom);
+        printf("\n  Preds:");
+        for (int j = 0; j < b->pred_count; j++)
+            printf(" B%d", preds[b->pred_first + j]);
+        printf("\n  Succs:");
         for (int j = 0; j < b->succ_count; j++)
-            printf(" B%d", b->succ[j]->id);
+            printf(" B%d", succs[b->succ_first + j]);
         printf("\n\n");
     }
 }
 
 BasicBlock *cfg_get_block(int index) {
-    if (index < 0 || index >= block_count) return NULL;
-    return blocks[index];
+    if (index < 0 || index >= block_count)
+        return NULL;
+    return &blocks[index];
 }
 
 int cfg_block_count(void) {
     return block_count;
 }
+
+const int *cfg_succs(const BasicBlock *b) {
+    return &succs[b->succ_first];
+}
+
+const int *cfg_preds(const BasicBlock *b) {
+    return &preds[b->pred_first];
+}
+
+const int *cfg_dom_children(const BasicBlock *b) {
+    return &dom_kids[b->dom_first];
+}
+
+const int *cfg_rpo(int *count) {
+    *count = rpo_count;
+    return rpo;
+}
+
+int cfg_label_block(uint32_t label) {
+    return label_block[label];
+}
+
+int cfg_dominates(int a, int b) {
+    if (blocks[a].rpo < 0 || blocks[b].rpo < 0)
+        return 0;
+    return blocks[a].dom_pre <= blocks[b].dom_pre && blocks[b].dom_post <= blocks[a].dom_post;
+}
@@ -6,55 +6,59 @@
 #include "../../include/semantic.h"
 
 static FILE *out;
+static const Ast *ast;
 
-static int is_string_literal(ASTNode *n) {
+static int is_string_literal(const ASTNode *n) {
     return n->type == AST_LITERAL &&
-           n->value &&
-           n->value[0] != '-' &&
-           !isdigit(n->value[0]) &&
-           strcmp(n->value, "true") != 0 &&
-           strcmp(n->value, "false") != 0;
+           n->value != ATOM_NONE &&
+           atom_str(n->value)[0] != '-' &&
+           !isdigit(atom_str(n->value)[0]) &&
+           n->value != ATOM_TRUE &&
+           n->value != ATOM_FALSE;
 }
 
-static void emit_declarations(ASTNode *root) {
-    if (!root || root->type != AST_BLOCK) return;
-
-    for (int i = 0; i < root->body_size; i++) {
-        ASTNode *n = root->body[i];
-        if (n->type == AST_ASSIGNMENT &&
-            n->left->type == AST_VAR_DECL) {
-
-            SemType t = semantic_get_type(n->left->value);
+// Variables are addressed by symbol: name_<SymbolId>, so shadowed
+// declarations in nested blocks get distinct C variables
+static void emit_var(SymbolId var) {
+    fprintf(out, "%s_%u", atom_str(semantic_symbol(var)->name), var);
+}
 
-            if (t == TYPE_STRING)
-                fprintf(out, "    char *%s;\n", n->left->value);
-            else if (t == TYPE_BOOLEAN)
-                fprintf(out, "    bool %s;\n", n->left->value);
-            else
-                fprintf(out, "    int %s;\n", n->left->value);
-        }
-        if (n->type == AST_FOR_STMT) {
-            ASTNode *init = n->left;
-            if (init && init->type == AST_ASSIGNMENT) {
-                fprintf(out, "    int %s;\n", init->left->value);
-            }
-        }
+static void emit_declarations(void) {
+    for (SymbolId var = 1; var < semantic_symbol_count(); var++) {
+        SemType t = semantic_symbol(var)->type;
+
+        if (t == TYPE_STRING)
+            fprintf(out, "    const char *");
+        else if (t == TYPE_BOOLEAN)
+            fprintf(out, "    bool ");
+        else
+            fprintf(out, "    int ");
+        emit_var(var);
+        fprintf(out, ";\n");
     }
 }
 
-static SemType expr_type(ASTNode *n) {
-    if (!n) return TYPE_NUMBER;
+// "++" or "--" of an update node whose text is e.g. "i++" or "--i"
+static const char *update_op(const ASTNode *n) {
+    const char *text = atom_str(n->value);
+    char c = n->type == AST_PRE_UPDATE ? text[0] : text[strlen(text) - 1];
+    return c == '+' ? "++" : "--";
+}
+
+static SemType expr_type(NodeId id) {
+    if (!id) return TYPE_NUMBER;
+    const ASTNode *n = ast_node(ast, id);
 
     switch (n->type) {
     case AST_LITERAL:
-        if (!strcmp(n->value, "true") || !strcmp(n->value, "false"))
+        if (n->value == ATOM_TRUE || n->value == ATOM_FALSE)
             return TYPE_BOOLEAN;
         if (is_string_literal(n))
             return TYPE_STRING;
         return TYPE_NUMBER;
 
     case AST_IDENTIFIER:
-        return semantic_get_type(n->value);
+        return n->sem_type;
 
     case AST_BINARY_OP:
         return expr_type(n->left);
@@ -67,37 +71,40 @@ static SemType expr_type(ASTNode *n) {
 
 
 
-static void emit_expr(ASTNode *n) {
-    if (!n) return;
+static void emit_expr(NodeId id) {
+    if (!id) return;
+    const ASTNode *n = ast_node(ast, id);
     
     switch (n->type) {
         
         case AST_LITERAL:
-            if (!strcmp(n->value, "true"))
+            if (n->value == ATOM_TRUE)
                 fprintf(out, "1");
-            else if (!strcmp(n->value, "false"))
+            else if (n->value == ATOM_FALSE)
                 fprintf(out, "0");
-            else if (strncmp(n->value, "0b", 2) == 0)
-                fprintf(out, "%d", (int)strtol(n->value + 2, NULL, 2));
-            else if (strncmp(n->value, "0x", 2) == 0)
-                fprintf(out, "%d", (int)strtol(n->value + 2, NULL, 16));
+            else if (strncmp(atom_str(n->value), "0b", 2) == 0)
+                fprintf(out, "%d", (int)strtol(atom_str(n->value) + 2, NULL, 2));
+            else if (strncmp(atom_str(n->value), "0x", 2) == 0)
+                fprintf(out, "%d", (int)strtol(atom_str(n->value) + 2, NULL, 16));
             else if (is_string_literal(n))
-                fprintf(out, "\"%s\"", n->value);
+                fprintf(out, "\"%s\"", atom_str(n->value));
             else
-                fprintf(out, "%s", n->value);
+                fprintf(out, "%s", atom_str(n->value));
             break;
 
         
     case AST_IDENTIFIER:
-    fprintf(out, "%s", n->value);
+    emit_var(n->sym);
     break;
 
     case AST_POST_UPDATE:
-        fprintf(out, "%s", n->value); // "i++"
+        emit_var(ast_node(ast, n->left)->sym);
+        fprintf(out, "%s", update_op(n)); // "i++"
         break;
 
     case AST_PRE_UPDATE:
-        fprintf(out, "%s", n->value); // "++i"
+        fprintf(out, "%s", update_op(n)); // "++i"
+        emit_var(ast_node(ast, n->left)->sym);
         break;
 
     
@@ -105,10 +112,12 @@ static void emit_expr(ASTNode *n) {
     fprintf(out, "(");
     emit_expr(n->left);
     
-    if (strcmp(n->value, "===") == 0)
+    if (n->value == ATOM_EQ_STRICT)
     fprintf(out, " == ");
+    else if (n->value == ATOM_NE_STRICT)
+    fprintf(out, " != ");
     else
-    fprintf(out, " %s ", n->value);
+    fprintf(out, " %s ", atom_str(n->value));
     
     emit_expr(n->right);
     fprintf(out, ")");
@@ -119,21 +128,105 @@ static void emit_expr(ASTNode *n) {
 }
 }
 
-static void emit_for_part(ASTNode *n) {
-    if (!n) return;
+static void emit_for_part(NodeId id) {
+    if (!id) return;
+    const ASTNode *n = ast_node(ast, id);
 
     if (n->type == AST_ASSIGNMENT) {
-        fprintf(out, "%s = ", n->left->value);
+        emit_var(ast_node(ast, n->left)->sym);
+        fprintf(out, " = ");
         emit_expr(n->right);
     } else if (n->type == AST_POST_UPDATE ||
                n->type == AST_PRE_UPDATE) {
-        fprintf(out, "%s", n->value);
+        emit_expr(id);
     }
 }
 
+// Does the subtree write var (assignment or ++/--)?
+static int writes_var(NodeId id, SymbolId var) {
+    if (!id) return 0;
+    const ASTNode *n = ast_node(ast, id);
+
+    if ((n->type == AST_ASSIGNMENT || n->type == AST_PRE_UPDATE ||
+         n->type == AST_POST_UPDATE) && ast_node(ast, n->left)->sym == var)
+        return 1;
+    if (writes_var(n->left, var) || writes_var(n->right, var))
+        return 1;
+    for (uint32_t i = 0; i < n->count; i++)
+        if (writes_var(ast_kid(ast, n, i), var))
+            return 1;
+    return 0;
+}
+
+// for (i = a; i < bound; i++) where the body leaves i and bound alone
+// and bound is not i. Returns the comparison node, or NODE_NONE.
+static NodeId counted_loop(const ASTNode *n) {
+    const ASTNode *init = ast_node(ast, n->left);
+    const ASTNode *cond = ast_node(ast, ast_kid(ast, n, 0));
+    const ASTNode *update = ast_node(ast, ast_kid(ast, n, 1));
+    NodeId body = ast_kid(ast, n, 2);
+
+    if (init->type != AST_ASSIGNMENT || cond->type != AST_BINARY_OP)
+        return NODE_NONE;
+    SymbolId var = ast_node(ast, init->left)->sym;
+    if (semantic_symbol(var)->type != TYPE_NUMBER)
+        return NODE_NONE;
+
+    if (cond->value != ATOM_LT && cond->value != ATOM_LE &&
+        cond->value != ATOM_GT && cond->value != ATOM_GE)
+        return NODE_NONE;
+
+    const ASTNode *lhs = ast_node(ast, cond->left);
+    const ASTNode *bound = ast_node(ast, cond->right);
+    if (lhs->type != AST_IDENTIFIER || lhs->sym != var)
+        return NODE_NONE;
+    if (bound->type == AST_IDENTIFIER ? bound->sym == var || writes_var(body, bound->sym)
+                                      : bound->type != AST_LITERAL)
+        return NODE_NONE;
+
+    if ((update->type != AST_POST_UPDATE && update->type != AST_PRE_UPDATE) ||
+        ast_node(ast, update->left)->sym != var || writes_var(body, var))
+        return NODE_NONE;
+    return ast_kid(ast, n, 0);
+}
+
+static void emit_stmt(NodeId id, int indent);
+
+// Counted loops get the bound in a const local and a bare induction
+// variable, the form the host compiler's vectorizer recognizes. The
+// init runs first, since it may write the bound.
+static void emit_counted_for(const ASTNode *n, NodeId cond_id, int indent) {
+    const ASTNode *cond = ast_node(ast, cond_id);
+
+    fprintf(out, "{\n");
+    for (int i = 0; i <= indent; i++)
+        fprintf(out, "    ");
+    emit_for_part(n->left);
+    fprintf(out, ";\n");
+
+    for (int i = 0; i <= indent; i++)
+        fprintf(out, "    ");
+    fprintf(out, "const int limit_%u = ", cond_id);
+    emit_expr(cond->right);
+    fprintf(out, ";\n");
+
+    for (int i = 0; i <= indent; i++)
+        fprintf(out, "    ");
+    fprintf(out, "for (; ");
+    emit_var(ast_node(ast, cond->left)->sym);
+    fprintf(out, " %s limit_%u; ", atom_str(cond->value), cond_id);
+    emit_expr(ast_kid(ast, n, 1));
+    fprintf(out, ") ");
+    emit_stmt(ast_kid(ast, n, 2), indent + 1);
+
+    for (int i = 0; i < indent; i++)
+        fprintf(out, "    ");
+    fprintf(out, "}\n");
+}
 
-static void emit_stmt(ASTNode *n, int indent) {
-    if (!n) return;
+static void emit_stmt(NodeId id, int indent) {
+    if (!id) return;
+    const ASTNode *n = ast_node(ast, id);
 
     for (int i = 0; i < indent; i++)
         fprintf(out, "    ");
@@ -141,12 +234,18 @@ static void emit_stmt(ASTNode *n, int indent) {
     switch (n->type) {
 
     case AST_ASSIGNMENT:
-        fprintf(out, "%s = ", n->left->value);
+        emit_var(ast_node(ast, n->left)->sym);
+        fprintf(out, " = ");
         emit_expr(n->right);
         fprintf(out, ";\n");
         break;
 
-        case AST_FOR_STMT:
+        case AST_FOR_STMT: {
+        NodeId counted = counted_loop(n);
+        if (counted) {
+            emit_counted_for(n, counted, indent);
+            break;
+        }
         fprintf(out, "for (");
 
         // init
@@ -154,33 +253,33 @@ static void emit_stmt(ASTNode *n, int indent) {
         fprintf(out, "; ");
 
         // condition
-        emit_expr(n->right->body[0]);
+        emit_expr(ast_kid(ast, n, 0));
         fprintf(out, "; ");
 
         // update
-        emit_expr(n->right->body[1]);
+        emit_expr(ast_kid(ast, n, 1));
 
         fprintf(out, ") ");
-        emit_stmt(n->right->body[2], indent);
+        emit_stmt(ast_kid(ast, n, 2), indent);
         break;
-
+    }
 
     case AST_FUNC_CALL:
-        if (strcmp(n->value, "console.log") == 0) {
-            SemType t = expr_type(n->body[0]);
+        if (n->value == ATOM_CONSOLE_LOG) {
+            SemType t = expr_type(ast_kid(ast, n, 0));
             if (t == TYPE_STRING)
                 fprintf(out, "printf(\"%%s\\n\", ");
             else
                 fprintf(out, "printf(\"%%d\\n\", ");
 
-            emit_expr(n->body[0]);
+            emit_expr(ast_kid(ast, n, 0));
             fprintf(out, ");\n");
         }
         break;
     case AST_BLOCK:
         fprintf(out, "{\n");
-        for (int i = 0; i < n->body_size; i++)
-            emit_stmt(n->body[i], indent + 1);
+        for (uint32_t i = 0; i < n->count; i++)
+            emit_stmt(ast_kid(ast, n, i), indent + 1);
         for (int i = 0; i < indent; i++)
             fprintf(out, "    ");
         fprintf(out, "}\n");
@@ -193,6 +292,12 @@ static void emit_stmt(ASTNode *n, int indent) {
         emit_stmt(n->right, indent);
         break;
 
+    // Follows the if it belongs to, as in the source
+    case AST_ELSE_STMT:
+        fprintf(out, "else ");
+        emit_stmt(n->right, indent);
+        break;
+
     case AST_WHILE_STMT:
         fprintf(out, "while (");
         emit_expr(n->left);
@@ -205,7 +310,7 @@ static void emit_stmt(ASTNode *n, int indent) {
     }
 }
 
-void codegen_c(ASTNode *root, const char *out_file) {
+void codegen_c(const Ast *tree, const char *out_file) {
     out = fopen(out_file, "w");
     if (!out) {
         perror("fopen");
@@ -216,12 +321,14 @@ void codegen_c(ASTNode *root, const char *out_file) {
         "#include <stdio.h>\n\n"
         "#include <stdbool.h>\n\n"
         "int main() {\n");
-    emit_declarations(root);
+    ast = tree;
+    const ASTNode *root = ast_node(ast, ast->root);
+    emit_declarations();
     if (root->type == AST_BLOCK) {
-        for (int i = 0; i < root->body_size; i++)
-            emit_stmt(root->body[i], 1);
+        for (uint32_t i = 0; i < root->count; i++)
+            emit_stmt(ast_kid(ast, root, i), 1);
     } else {
-        emit_stmt(root, 1);
+        emit_stmt(ast->root, 1);
     }
 
     fprintf(out, "    return 0;\n}\n");
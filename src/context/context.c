@@ -0,0 +1,15 @@
+#include <string.h>
+#include "../../include/context.h"
+#include "../../include/intern.h"
+
+void context_init(CompileContext *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ast_init(&ctx->ast);
+}
+
+void context_free(CompileContext *ctx)
+{
+    ast_free(&ctx->ast);
+    intern_free();
+}
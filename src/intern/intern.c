@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/intern.h"
+#include "../../include/arena.h"
+
+typedef struct {
+    const char *text;
+    uint32_t len;
+    uint32_t hash;
+} AtomInfo;
+
+static Arena strings;
+static AtomInfo *atoms;
+static uint32_t count, capacity;
+
+// Open-addressing table of atoms, 0 marks an empty slot
+static Atom *slots;
+static uint32_t slot_mask;
+
+// Single-byte names (operators, punctuation) skip the hash entirely
+static Atom single_byte[256];
+
+static const char *well_known[] = {
+    "",
+#define ATOM(name, text) text,
+#include "atoms.def"
+};
+
+static void *xrealloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (!p) {
+        perror("realloc");
+        exit(1);
+    }
+    return p;
+}
+
+static uint32_t hash_bytes(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+static void rehash(uint32_t new_size)
+{
+    free(slots);
+    slots = calloc(new_size, sizeof(Atom));
+    if (!slots) {
+        perror("calloc");
+        exit(1);
+    }
+    slot_mask = new_size - 1;
+
+    for (Atom a = 1; a < count; a++) {
+        uint32_t i = atoms[a].hash & slot_mask;
+        while (slots[i])
+            i = (i + 1) & slot_mask;
+        slots[i] = a;
+    }
+}
+
+static Atom add_atom(const char *s, size_t len, uint32_t hash)
+{
+    if (count == capacity) {
+        capacity = capacity ? capacity * 2 : 1024;
+        atoms = xrealloc(atoms, sizeof(AtomInfo) * capacity);
+    }
+
+    Atom a = count++;
+    atoms[a].text = arena_strndup(&strings, s, len);
+    atoms[a].len = (uint32_t)len;
+    atoms[a].hash = hash;
+
+    // Keep the load factor under 1/2
+    if (count * 2 > slot_mask + 1) {
+        rehash((slot_mask + 1) * 2);
+    } else {
+        uint32_t i = hash & slot_mask;
+        while (slots[i])
+            i = (i + 1) & slot_mask;
+        slots[i] = a;
+    }
+
+    if (len == 1)
+        single_byte[(unsigned char)s[0]] = a;
+    return a;
+}
+
+static void intern_init(void)
+{
+    count = 1; // atom 0 is ATOM_NONE
+    capacity = 1024;
+    atoms = xrealloc(NULL, sizeof(AtomInfo) * capacity);
+    atoms[0] = (AtomInfo){"", 0, 0};
+    rehash(2048);
+
+    for (size_t i = 1; i < sizeof(well_known) / sizeof(well_known[0]); i++)
+        intern_cstr(well_known[i]);
+}
+
+Atom intern(const char *s, size_t len)
+{
+    if (!atoms)
+        intern_init();
+
+    if (len == 1 && single_byte[(unsigned char)s[0]])
+        return single_byte[(unsigned char)s[0]];
+
+    uint32_t h = hash_bytes(s, len);
+    for (uint32_t i = h & slot_mask; slots[i]; i = (i + 1) & slot_mask) {
+        AtomInfo *info = &atoms[slots[i]];
+        if (info->hash == h && info->len == len && memcmp(info->text, s, len) == 0)
+            return slots[i];
+    }
+    return add_atom(s, len, h);
+}
+
+Atom intern_cstr(const char *s)
+{
+    return intern(s, strlen(s));
+}
+
+const char *atom_str(Atom atom)
+{
+    return atom < count ? atoms[atom].text : "";
+}
+
+size_t atom_len(Atom atom)
+{
+    return atom < count ? atoms[atom].len : 0;
+}
+
+uint32_t atom_count(void)
+{
+    return count;
+}
+
+void intern_free(void)
+{
+    arena_free(&strings);
+    free(atoms);
+    free(slots);
+    atoms = NULL;
+    slots = NULL;
+    count = capacity = slot_mask = 0;
+    memset(single_byte, 0, sizeof(single_byte));
+}
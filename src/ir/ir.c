@@ -5,152 +5,414 @@
 
 static int tempCount = 0;
 static int labelCount = 0;
-static IRInstr ir[1024];
+static IRInstr *ir;
 static int ir_count = 0;
+static int ir_capacity = 0;
+static IROperand *phi_args;
+static int phi_arg_count = 0;
+static int phi_arg_capacity = 0;
+static IRConst *consts;
+static int const_count = 0;
+static int const_capacity = 0;
+static const Ast *ast;
 
 static void emit(IRInstr i)
 {
+    if (ir_count >= ir_capacity)
+    {
+        ir_capacity = ir_capacity ? ir_capacity * 2 : 1024;
+        ir = realloc(ir, sizeof(IRInstr) * ir_capacity);
+        if (!ir)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
     ir[ir_count++] = i;
 }
 
-static char *strdup_safe(const char *s)
+IRInstr *ir_get_all(int *count) {
+    *count = ir_count;
+    return ir;
+}
+
+
+const IRConst *ir_const(uint32_t index)
+{
+    return &consts[index];
+}
+
+int ir_temp_count(void)
+{
+    return tempCount;
+}
+
+int ir_label_count(void)
 {
-    if (!s)
-        return NULL;
-    size_t len = strlen(s) + 1;
-    char *copy = malloc(len);
-    if (!copy)
+    return labelCount;
+}
+
+int ir_uses(IRInstr *in, IROperand **uses)
+{
+    switch (in->op)
     {
-        perror("malloc");
-        exit(1);
+    case IR_ASSIGN:
+    case IR_IF_FALSE:
+    case IR_PARAM:
+        uses[0] = &in->lhs;
+        return 1;
+    default:
+        if (!IR_IS_BINARY(in->op))
+            return 0;
+        uses[0] = &in->lhs;
+        uses[1] = &in->rhs;
+        return 2;
     }
-    memcpy(copy, s, len);
-    return copy;
 }
 
-IRInstr *ir_get_all(int *count) {
-    *count = ir_count;
-    return ir;
+IROperand *ir_def(IRInstr *in)
+{
+    if (in->op == IR_ASSIGN || in->op == IR_PHI || IR_IS_BINARY(in->op))
+        return &in->dst;
+    return NULL;
 }
 
+/* ---------- Operands ---------- */
+
+static IROperand new_temp()
+{
+    return (IROperand){.kind = OPD_TEMP, .index = (uint32_t)tempCount++};
+}
 
-static char *new_temp()
+static IROperand new_label()
 {
-    static char buf[16];
-    snprintf(buf, sizeof(buf), "t%d", tempCount++);
-    return buf;
+    return (IROperand){.kind = OPD_LABEL, .index = (uint32_t)labelCount++};
 }
 
-static char *new_label()
+IROperand ir_new_temp(void)
 {
-    static char buf[16];
-    snprintf(buf, sizeof(buf), "L%d", labelCount++);
-    return buf;
+    return new_temp();
 }
 
-static char *gen_expr(ASTNode *node)
+IROperand ir_new_label(void)
 {
-    if (!node)
-        return "";
+    return new_label();
+}
+
+// Arguments start out undefined (OPD_NONE)
+IRInstr ir_new_phi(SymbolId var, int argc)
+{
+    if (phi_arg_count + argc > phi_arg_capacity)
+    {
+        while (phi_arg_count + argc > phi_arg_capacity)
+            phi_arg_capacity = phi_arg_capacity ? phi_arg_capacity * 2 : 256;
+        phi_args = realloc(phi_args, sizeof(IROperand) * phi_arg_capacity);
+        if (!phi_args)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    memset(&phi_args[phi_arg_count], 0, sizeof(IROperand) * argc);
+
+    IRInstr phi = {
+        .op = IR_PHI,
+        .argc = (uint16_t)argc,
+        .lhs = {.kind = OPD_NONE, .index = (uint32_t)phi_arg_count},
+        .rhs = {.kind = OPD_VAR, .index = var}};
+    phi_arg_count += argc;
+    return phi;
+}
+
+IROperand *ir_phi_args(const IRInstr *phi)
+{
+    return &phi_args[phi->lhs.index];
+}
+
+void ir_replace(IRInstr *instrs, int count, int capacity)
+{
+    if (instrs != ir)
+        free(ir);
+    ir = instrs;
+    ir_count = count;
+    ir_capacity = capacity;
+}
+
+static IROperand var_operand(SymbolId var)
+{
+    return (IROperand){.kind = OPD_VAR, .index = var};
+}
+
+static IROperand const_operand(IRConst c)
+{
+    if (const_count >= const_capacity)
+    {
+        const_capacity = const_capacity ? const_capacity * 2 : 64;
+        consts = realloc(consts, sizeof(IRConst) * const_capacity);
+        if (!consts)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    consts[const_count] = c;
+    return (IROperand){.kind = OPD_CONST, .index = (uint32_t)const_count++};
+}
+
+// Literal text is parsed once here; backends only see immediates
+static IROperand literal_operand(const ASTNode *node)
+{
+    if (node->value == ATOM_TRUE || node->value == ATOM_FALSE)
+        return (IROperand){.kind = OPD_INT, .imm = node->value == ATOM_TRUE};
+    if (node->sem_type == TYPE_STRING)
+        return (IROperand){.kind = OPD_STR, .index = node->value};
+
+    const char *text = atom_str(node->value);
+    int64_t value;
+    if (!strncmp(text, "0x", 2) || !strncmp(text, "0X", 2))
+        value = strtoll(text + 2, NULL, 16);
+    else if (!strncmp(text, "0b", 2) || !strncmp(text, "0B", 2))
+        value = strtoll(text + 2, NULL, 2);
+    else if (!strncmp(text, "0o", 2) || !strncmp(text, "0O", 2))
+        value = strtoll(text + 2, NULL, 8);
+    else if (strpbrk(text, ".eE"))
+        return const_operand((IRConst){.is_double = 1, .d = strtod(text, NULL)});
+    else
+        value = strtoll(text, NULL, 10);
+
+    if (value >= INT32_MIN && value <= INT32_MAX)
+        return (IROperand){.kind = OPD_INT, .imm = (int32_t)value};
+    return const_operand((IRConst){.is_double = 0, .i = value});
+}
+
+static IROp binary_op(Atom op)
+{
+    switch (op)
+    {
+    case ATOM_PLUS:      return IR_ADD;
+    case ATOM_MINUS:     return IR_SUB;
+    case ATOM_STAR:      return IR_MUL;
+    case ATOM_SLASH:     return IR_DIV;
+    case ATOM_EQ:
+    case ATOM_EQ_STRICT: return IR_EQ;
+    case ATOM_NE:
+    case ATOM_NE_STRICT: return IR_NE;
+    case ATOM_LT:        return IR_LT;
+    case ATOM_GT:        return IR_GT;
+    case ATOM_LE:        return IR_LE;
+    case ATOM_GE:        return IR_GE;
+    default:
+        printf("Internal Error: no IR for operator '%s'\n", atom_str(op));
+        exit(1);
+    }
+}
+
+/* ---------- Generation ---------- */
+
+static IROperand gen_expr(NodeId id)
+{
+    if (!id)
+        return (IROperand){.kind = OPD_NONE};
+    const ASTNode *node = ast_node(ast, id);
 
     switch (node->type)
     {
     case AST_LITERAL:
+        return literal_operand(node);
+
     case AST_IDENTIFIER:
-        return node->value;
+        return var_operand(node->sym);
 
     case AST_BINARY_OP:
     {
-        char *l = gen_expr(node->left);
-        char *r = gen_expr(node->right);
-        char *t = strdup_safe(new_temp());
+        IROperand l = gen_expr(node->left);
+        IROperand r = gen_expr(node->right);
+        IROperand t = new_temp();
         emit((IRInstr){
-            .op = IR_BINOP,
+            .op = binary_op(node->value),
             .dst = t,
             .lhs = l,
-            .op_str = node->value,
             .rhs = r});
         return t;
     }
 
     default:
-        return "";
+        return (IROperand){.kind = OPD_NONE};
     }
 }
 
-static void gen_stmt(ASTNode *node)
+// i++ / ++i / i-- / --i as statements: i = i +/- 1
+static void gen_update(const ASTNode *node)
+{
+    const char *text = atom_str(node->value);
+    char c = node->type == AST_PRE_UPDATE ? text[0] : text[strlen(text) - 1];
+    IROperand var = var_operand(ast_node(ast, node->left)->sym);
+    IROperand t = new_temp();
+    emit((IRInstr){
+        .op = c == '+' ? IR_ADD : IR_SUB,
+        .dst = t,
+        .lhs = var,
+        .rhs = {.kind = OPD_INT, .imm = 1}});
+    emit((IRInstr){
+        .op = IR_ASSIGN,
+        .dst = var,
+        .lhs = t});
+}
+
+static void gen_stmt(NodeId id);
+
+// Every loop is entered through an empty block of its own, whatever
+// comes before it, so loop passes always have a place to hoist code to
+static void emit_preheader(void)
+{
+    emit((IRInstr){
+        .op = IR_LABEL,
+        .dst = new_label()});
+}
+
+// The parser keeps "else" as the statement after its "if"; pass it in
+// as else_body (NODE_NONE when there is none)
+static void gen_if(const ASTNode *node, NodeId else_body)
 {
-    if (!node)
+    IROperand cond = gen_expr(node->left);
+    IROperand Lfalse = new_label();
+    emit((IRInstr){
+        .op = IR_IF_FALSE,
+        .dst = Lfalse,
+        .lhs = cond});
+    gen_stmt(node->right);
+
+    if (!else_body)
+    {
+        emit((IRInstr){
+            .op = IR_LABEL,
+            .dst = Lfalse});
+        return;
+    }
+
+    IROperand Lend = new_label();
+    emit((IRInstr){
+        .op = IR_GOTO,
+        .dst = Lend});
+    emit((IRInstr){
+        .op = IR_LABEL,
+        .dst = Lfalse});
+    gen_stmt(else_body);
+    emit((IRInstr){
+        .op = IR_LABEL,
+        .dst = Lend});
+}
+
+static void gen_stmt(NodeId id)
+{
+    if (!id)
         return;
+    const ASTNode *node = ast_node(ast, id);
 
     switch (node->type)
     {
 
     case AST_ASSIGNMENT:
     {
-        char *rhs = gen_expr(node->right);
+        IROperand rhs = gen_expr(node->right);
         emit((IRInstr){
             .op = IR_ASSIGN,
-            .dst = node->left->value,
+            .dst = var_operand(ast_node(ast, node->left)->sym),
             .lhs = rhs});
 
         break;
     }
 
     case AST_IF_STMT:
+        gen_if(node, NODE_NONE);
+        break;
+
+    case AST_ELSE_STMT: // without a matching if
+        gen_stmt(node->right);
+        break;
+
+    case AST_PRE_UPDATE:
+    case AST_POST_UPDATE:
+        gen_update(node);
+        break;
+
+    case AST_WHILE_STMT:
     {
-        char *cond = gen_expr(node->left);
-        char *Lfalse = new_label();
+        IROperand Lstart = new_label();
+        IROperand Lend = new_label();
+        emit_preheader();
+        emit((IRInstr){
+            .op = IR_LABEL,
+            .dst = Lstart});
+        IROperand cond = gen_expr(node->left);
         emit((IRInstr){
             .op = IR_IF_FALSE,
-            .lhs = cond,
-            .label = Lfalse});
+            .dst = Lend,
+            .lhs = cond});
         gen_stmt(node->right);
+        emit((IRInstr){
+            .op = IR_GOTO,
+            .dst = Lstart});
         emit((IRInstr){
             .op = IR_LABEL,
-            .label = Lfalse});
+            .dst = Lend});
         break;
     }
 
-    case AST_WHILE_STMT:
+    case AST_FOR_STMT:
     {
-        char *Lstart = new_label();
-        char *Lend = new_label();
+        // init; Lcond: if !cond goto Lend; body; update; goto Lcond; Lend:
+        IROperand Lcond = new_label();
+        IROperand Lend = new_label();
+        gen_stmt(node->left);
+        emit_preheader();
         emit((IRInstr){
             .op = IR_LABEL,
-            .label = Lstart});
-        char *cond = gen_expr(node->left);
+            .dst = Lcond});
+        IROperand cond = gen_expr(ast_kid(ast, node, 0));
         emit((IRInstr){
             .op = IR_IF_FALSE,
-            .lhs = cond,
-            .label = Lend});
-        gen_stmt(node->right);
+            .dst = Lend,
+            .lhs = cond});
+        gen_stmt(ast_kid(ast, node, 2));
+        gen_stmt(ast_kid(ast, node, 1));
         emit((IRInstr){
             .op = IR_GOTO,
-            .label = Lstart});
+            .dst = Lcond});
         emit((IRInstr){
             .op = IR_LABEL,
-            .label = Lend});
+            .dst = Lend});
         break;
     }
 
     case AST_BLOCK:
-        for (int i = 0; i < node->body_size; i++)
-            gen_stmt(node->body[i]);
+        for (uint32_t i = 0; i < node->count; i++)
+        {
+            NodeId kid = ast_kid(ast, node, i);
+            const ASTNode *k = ast_node(ast, kid);
+            NodeId next = i + 1 < node->count ? ast_kid(ast, node, i + 1) : NODE_NONE;
+
+            if (k->type == AST_IF_STMT && next && ast_node(ast, next)->type == AST_ELSE_STMT)
+            {
+                gen_if(k, ast_node(ast, next)->right);
+                i++;
+            }
+            else
+                gen_stmt(kid);
+        }
         break;
 
     case AST_FUNC_CALL:
-        for (int i = 0; i < node->body_size; i++)
+        for (uint32_t i = 0; i < node->count; i++)
         {
-            char *arg = gen_expr(node->body[i]);
             emit((IRInstr){
                 .op = IR_PARAM,
-                .lhs = arg});
+                .lhs = gen_expr(ast_kid(ast, node, i))});
         }
         emit((IRInstr){
             .op = IR_CALL,
-            .func = node->value,
-            .argc = node->body_size});
+            .callee = CALLEE_CONSOLE_LOG,
+            .argc = node->count});
         break;
 
     default:
@@ -158,7 +420,116 @@ static void gen_stmt(ASTNode *node)
     }
 }
 
-void ir_generate(ASTNode *root)
+void ir_generate(const Ast *tree)
+{
+    ast = tree;
+    gen_stmt(tree->root);
+    emit((IRInstr){.op = IR_RET});
+}
+
+/* ---------- Debug output ---------- */
+
+static const char *const binop_names[IR_OP_COUNT] = {
+    [IR_ADD] = "+",
+    [IR_SUB] = "-",
+    [IR_MUL] = "*",
+    [IR_DIV] = "/",
+    [IR_EQ] = "==",
+    [IR_NE] = "!=",
+    [IR_LT] = "<",
+    [IR_GT] = ">",
+    [IR_LE] = "<=",
+    [IR_GE] = ">=",
+};
+
+static void print_operand(IROperand v)
 {
-    gen_stmt(root);
+    switch (v.kind)
+    {
+    case OPD_TEMP:
+        printf("t%u", v.index);
+        break;
+    case OPD_VAR:
+        printf("%s.%u", atom_str(semantic_symbol(v.index)->name), v.index);
+        break;
+    case OPD_INT:
+        printf("%d", v.imm);
+        break;
+    case OPD_CONST:
+        if (consts[v.index].is_double)
+            printf("%g", consts[v.index].d);
+        else
+            printf("%lld", (long long)consts[v.index].i);
+        break;
+    case OPD_STR:
+        printf("\"%s\"", atom_str(v.index));
+        break;
+    case OPD_LABEL:
+        printf("L%u", v.index);
+        break;
+    default:
+        printf("_");
+        break;
+    }
+}
+
+void ir_print(void)
+{
+    for (int i = 0; i < ir_count; i++)
+    {
+        const IRInstr *in = &ir[i];
+        printf("%4d: ", i);
+        switch (in->op)
+        {
+        case IR_ASSIGN:
+            print_operand(in->dst);
+            printf(" = ");
+            print_operand(in->lhs);
+            break;
+        case IR_LABEL:
+            print_operand(in->dst);
+            printf(":");
+            break;
+        case IR_GOTO:
+            printf("goto ");
+            print_operand(in->dst);
+            break;
+        case IR_IF_FALSE:
+            printf("ifFalse ");
+            print_operand(in->lhs);
+            printf(" goto ");
+            print_operand(in->dst);
+            break;
+        case IR_PARAM:
+            printf("param ");
+            print_operand(in->lhs);
+            break;
+        case IR_CALL:
+            printf("call console.log, %d", in->argc);
+            break;
+        case IR_NOP:
+            printf("nop");
+            break;
+        case IR_RET:
+            printf("ret");
+            break;
+        case IR_PHI:
+            print_operand(in->dst);
+            printf(" = phi");
+            for (int j = 0; j < in->argc; j++)
+            {
+                printf(j ? ", " : " ");
+                print_operand(ir_phi_args(in)[j]);
+            }
+            break;
+        default:
+            print_operand(in->dst);
+            printf(" = ");
+            print_operand(in->lhs);
+            printf(" %s ", binop_names[in->op]);
+            print_operand(in->rhs);
+            break;
+        }
+        printf("\n");
+    }
 }
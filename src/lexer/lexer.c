@@ -1,421 +1,373 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
-#include <wctype.h>
-
-#define MAX_TOKEN_LENGTH 256
-
-typedef enum
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/lexer.h"
+#include "../../include/scan.h"
+
+#include "kw_hash.h"
+
+const char *keywords[] = {
+    NULL,
+#define KEYWORD(name, text) text,
+#include "keywords.def"
+};
+
+const char *built_in_objects[] = {
+    NULL,
+#define BUILTIN(name, text) text,
+#include "keywords.def"
+};
+
+
+BuiltinObject is_builtInObject(const char *str, size_t len)
 {
-    TOKEN_IDENTIFIER,
-    TOKEN_KEYWORD,
-    TOKEN_NUMBER,
-    TOKEN_STRING,
-    TOKEN_OPERATOR,
-    TOKEN_PUNCTUATION,
-    TOKEN_PARENTHESES,
-    TOKEN_SEMICOLON,
-    TOKEN_BOOLEAN,
-    TOKEN_EOF,
-    TOKEN_COMMENT,
-    TOKEN_ERROR
-} TokenType;
-
-typedef struct
+    const KwSlot *slot = kw_lookup(str, len);
+    return slot && slot->is_builtin ? (BuiltinObject)slot->id : BUILTIN_NONE;
+}
+
+Keyword is_keyword(const char *str, size_t len)
 {
-    TokenType type;
-    char lexeme[MAX_TOKEN_LENGTH];
-    int line;
-} Token;
+    const KwSlot *slot = kw_lookup(str, len);
+    return slot && !slot->is_builtin ? (Keyword)slot->id : KW_NONE;
+}
 
-const char *keywords[] = {"abstract", "arguments", "await", "boolean", "break", "byte", "case", "catch", "char", "class", "const", "continue", "debugger", "default", "delete", "do", "double", "else", "enum", "eval", "export", "extends", "false", "final", "finally", "float", "for", "function", "goto", "if", "implements", "import", "in", "instanceof", "int", "interface", "let", "long", "native", "new", "null", "package", "private", "protected", "public", "return", "short", "static", "super", "switch", "synchronized", "this", "throw", "throws", "transient", "try", "typeof", "var", "void", "volatile", "while", "with", "yield"};
+const char *keyword_text(Keyword kw)
+{
+    return kw > KW_NONE && kw < KW_COUNT ? keywords[kw] : "";
+}
 
-const char *built_in_objects[] = {"Object", "Function", "Boolean", "Symbol", "Error", "EvalError", "RangeError", "ReferenceError", "SyntaxError", "TypeError", "URIError", "Number", "BigInt", "Math", "Date", "String", "RegExp", "Array", "Int8Array", "Uint8Array", "Uint8ClampedArray", "Int16Array", "Uint16Array", "Int32Array", "Uint32Array", "BigInt64Array", "BigUint64Array", "Float32Array", "Float64Array", "ArrayBuffer", "SharedArrayBuffer", "DataView", "Map", "Set", "WeakMap", "WeakSet", "JSON", "Atomics", "Promise", "Generator", "GeneratorFunction", "AsyncFunction", "Reflect", "Proxy"};
+/* ---------- Source buffers ---------- */
 
+void lexer_init(Lexer *lexer, const char *src, size_t len)
+{
+    lexer->src = src;
+    lexer->len = len;
+    lexer->pos = 0;
+    lexer->line = 1;
+    lexer->mapped = 0;
+    lexer->owned = 0;
+    lexer->defer_atoms = 0;
+    scan_init();
+}
 
-int is_builtInObject(const char *str)
+static int read_all(Lexer *lexer, int fd)
 {
-    for (size_t i = 0; i < sizeof(built_in_objects) / sizeof(built_in_objects[0]); i++)
+    size_t cap = 4096, len = 0;
+    char *buf = malloc(cap);
+    if (!buf)
+        return -1;
+
+    for (;;)
     {
-        if (strcmp(str, built_in_objects[i]) == 0)
+        if (len == cap)
+        {
+            char *grown = realloc(buf, cap * 2);
+            if (!grown)
+            {
+                free(buf);
+                return -1;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, buf + len, cap - len);
+        if (n < 0)
         {
-            return 1;
+            if (errno == EINTR)
+                continue;
+            free(buf);
+            return -1;
         }
+        if (n == 0)
+            break;
+        len += (size_t)n;
     }
+
+    lexer_init(lexer, buf, len);
+    lexer->owned = 1;
     return 0;
 }
 
-int is_keyword(const char *str)
+int lexer_open(Lexer *lexer, const char *path)
 {
-    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Token offsets are 32-bit
+    if ((uint64_t)st.st_size > UINT32_MAX)
+    {
+        close(fd);
+        errno = EFBIG;
+        return -1;
+    }
+
+    int rc = 0;
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
     {
-        if (strcmp(str, keywords[i]) == 0)
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
         {
-            return 1;
+            // The lexer reads front to back exactly once
+            posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            lexer_init(lexer, map, (size_t)st.st_size);
+            lexer->mapped = 1;
+        }
+        else
+        {
+            rc = read_all(lexer, fd);
         }
     }
-    return 0;
+    else
+    {
+        rc = read_all(lexer, fd);
+    }
+
+    close(fd);
+    return rc;
+}
+
+void lexer_close(Lexer *lexer)
+{
+    if (lexer->mapped)
+        munmap((void *)lexer->src, lexer->len);
+    else if (lexer->owned)
+        free((void *)lexer->src);
+    lexer_init(lexer, "", 0);
+}
+
+/* ---------- Scanning ---------- */
+
+static int peek(Lexer *lexer, size_t ahead)
+{
+    size_t at = lexer->pos + ahead;
+    return at < lexer->len ? (unsigned char)lexer->src[at] : EOF;
 }
 
-int advance(FILE *file)
+static Token make_token(Lexer *lexer, TokenType type, size_t start, size_t end, int line)
 {
-    return fgetc(file); // Read the next character from the file
+    Atom atom = ATOM_NONE;
+    if (type != TOKEN_EOF && !lexer->defer_atoms)
+        atom = intern(lexer->src + start, end - start);
+    return (Token){(uint32_t)start, (uint32_t)(end - start), atom, (uint16_t)type, KW_NONE, line};
 }
 
-int peek(FILE *file)
+static void skip_digits(Lexer *lexer, int (*accept)(int))
 {
-    int ch = fgetc(file); // Read the next character
-    ungetc(ch, file);     // Put it back for future reads
-    return ch;            // Return the character
+    while (lexer->pos < lexer->len && accept((unsigned char)lexer->src[lexer->pos]))
+        lexer->pos++;
 }
 
-Token get_next_token(FILE *file)
+static int is_bin_digit(int ch) { return ch == '0' || ch == '1'; }
+static int is_oct_digit(int ch) { return ch >= '0' && ch <= '7'; }
+static int is_dec_digit(int ch) { return isdigit(ch); }
+static int is_hex_digit(int ch) { return isxdigit(ch); }
+
+Token lexer_next(Lexer *lexer)
 {
-    static int line = 1;
-    int ch;
+    const char *src = lexer->src;
 
-    while ((ch = fgetc(file)) != EOF)
+    while (lexer->pos < lexer->len)
     {
+        size_t start = lexer->pos;
+        int ch = (unsigned char)src[lexer->pos++];
+
         if (isspace(ch))
         {
-            if (ch == '\n')
-                line++;
+            // Skip the whole whitespace run at once
+            lexer->pos = scan_space(src, start, lexer->len, &lexer->line);
             continue;
         }
 
-        Token token;
-        token.line = line;
+        int line = lexer->line;
 
         if (isalpha(ch) || ch == '_')
         {
             // Identifier or keyword
-            char buffer[MAX_TOKEN_LENGTH] = {ch};
-            int index = 1;
+            lexer->pos = scan_ident(src, lexer->pos, lexer->len);
 
-            while (isalnum(ch = fgetc(file)) || ch == '_')
-            {
-                if (index < MAX_TOKEN_LENGTH - 1)
-                {
-                    buffer[index++] = ch;
-                }
-            }
-            buffer[index] = '\0';
-            ungetc(ch, file);
-
-            strcpy(token.lexeme, buffer);
-            //prepare above conditions in if else if statement:
-            if (is_keyword(buffer))
-            token.type = TOKEN_KEYWORD;
-            else if ((strcmp(buffer, "true") == 0 || strcmp(buffer, "false") == 0))
-            token.type = TOKEN_BOOLEAN;
-            else
-            token.type = TOKEN_IDENTIFIER;
-            // token.type = (strcmp(buffer, "true") == 0 || strcmp(buffer, "false") == 0) ? TOKEN_BOOLEAN : TOKEN_IDENTIFIER;
+            Keyword kw = is_keyword(src + start, lexer->pos - start);
+            TokenType type = TOKEN_IDENTIFIER;
+            if (kw == KW_TRUE || kw == KW_FALSE)
+                type = TOKEN_BOOLEAN;
+            else if (kw != KW_NONE)
+                type = TOKEN_KEYWORD;
+
+            Token token = make_token(lexer, type, start, lexer->pos, line);
+            token.kw = (uint16_t)kw;
             return token;
         }
 
         if (isdigit(ch))
         {
-            char buffer[MAX_TOKEN_LENGTH];
-            int index = 0;
-            int has_dot = 0, has_exp = 0;
-
-            buffer[index++] = ch;
+            int next = peek(lexer, 0);
 
-            if (ch == '0')
-            {
-                // Check for hex, binary, octal
-                char next = fgetc(file);
-                if (next == 'x' || next == 'X')
-                { // Hexadecimal
-                    buffer[index++] = next;
-                    while (isxdigit(ch = fgetc(file)))
-                        buffer[index++] = ch;
-                }
-                else if (next == 'b' || next == 'B')
-                { // Binary
-                    buffer[index++] = next;
-                    while (ch == '0' || ch == '1')
-                        buffer[index++] = ch, ch = fgetc(file);
-                }
-                else if (next == 'o' || next == 'O')
-                { // Octal
-                    buffer[index++] = next;
-                    while (ch >= '0' && ch <= '7')
-                        buffer[index++] = ch, ch = fgetc(file);
-                }
-                else
-                {
-                    ungetc(next, file); // Put back if not part of a special format
-                }
-                if (!isalnum(ch) && ch != '_')
-                {
-                    ungetc(ch, file);
-                }
+            if (ch == '0' && (next == 'x' || next == 'X'))
+            { // Hexadecimal
+                lexer->pos++;
+                skip_digits(lexer, is_hex_digit);
+            }
+            else if (ch == '0' && (next == 'b' || next == 'B'))
+            { // Binary
+                lexer->pos++;
+                skip_digits(lexer, is_bin_digit);
+            }
+            else if (ch == '0' && (next == 'o' || next == 'O'))
+            { // Octal
+                lexer->pos++;
+                skip_digits(lexer, is_oct_digit);
             }
             else
             {
-                while (1)
+                skip_digits(lexer, is_dec_digit);
+
+                // Handle decimal point (only one allowed)
+                if (peek(lexer, 0) == '.')
                 {
-                    ch = fgetc(file);
+                    lexer->pos++;
+                    skip_digits(lexer, is_dec_digit);
+                }
 
-                    if (isdigit(ch))
-                    {
-                        buffer[index++] = ch;
-                    }
-                    else if (ch == '.' && !has_dot)
-                    {
-                        // Handle decimal point (only one allowed)
-                        has_dot = 1;
-                        buffer[index++] = ch;
-                    }
-                    else if ((ch == 'e' || ch == 'E') && !has_exp)
-                    {
-                        // Handle scientific notation
-                        has_exp = 1;
-                        buffer[index++] = ch;
-                        ch = fgetc(file);
-
-                        if (ch == '+' || ch == '-')
-                        {
-                            // Allow exponent sign
-                            buffer[index++] = ch;
-                        }
-                        else
-                        {
-                            ungetc(ch, file); // Put back if not a valid sign
-                        }
-                    }
-                    else
-                    {
-                        ungetc(ch, file); // Stop processing
-                        break;
-                    }
+                // Handle scientific notation, with optional exponent sign
+                if (peek(lexer, 0) == 'e' || peek(lexer, 0) == 'E')
+                {
+                    lexer->pos++;
+                    if (peek(lexer, 0) == '+' || peek(lexer, 0) == '-')
+                        lexer->pos++;
+                    skip_digits(lexer, is_dec_digit);
                 }
             }
 
-            buffer[index] = '\0';
-            strcpy(token.lexeme, buffer);
-            token.type = TOKEN_NUMBER;
-            return token;
+            return make_token(lexer, TOKEN_NUMBER, start, lexer->pos, line);
         }
 
         if (ch == '`')
         {
-            advance(file);
-            while (ch != '`' && ch != '\0')
+            // Template literal, `${}` substitutions are kept verbatim
+            int depth = 0;
+            for (;;)
             {
-                if (ch == '$' && peek(file) == '{')
-                {                  // Handle `${}`
-                    advance(file); // Consume '$'
-                    advance(file); // Consume '{'
-                    while (ch != '}' && ch != '\0')
-                    {
-                        advance(file);
-                    }
-                    if (ch == '}')
-                        advance(file); // Consume '}'
-                }
-                advance(file);
+                lexer->pos = scan_until(src, lexer->pos, lexer->len, "`\\$}", &lexer->line);
+                if ((ch = peek(lexer, 0)) == EOF || (ch == '`' && depth == 0))
+                    break;
+                if (ch == '\\' && peek(lexer, 1) != EOF)
+                    lexer->pos++;
+                else if (ch == '$' && peek(lexer, 1) == '{')
+                    depth++, lexer->pos++;
+                else if (ch == '}' && depth > 0)
+                    depth--;
+                lexer->pos++;
             }
+            Token token = make_token(lexer, TOKEN_STRING, start + 1, lexer->pos, line);
             if (ch == '`')
-                advance(file); // Consume closing backtick
-            return (Token){TOKEN_STRING, "TEMPLATE_LITERAL", line};
+                lexer->pos++; // Consume closing backtick
+            return token;
         }
 
-        // if (ch == 'true' || ch == 'false')
-        // {
-        //     advance(file);
-        //     return (Token){TOKEN_BOOLEAN, ch == 't' ? "true" : "false"};
-        // }
-
         if (ch == '"' || ch == '\'')
         {
-            char quoteType = ch;
-            int index = 0;
-
-            while ((ch = fgetc(file)) != quoteType && ch != EOF)
+            // Escape sequences are left in the span for the consumer to decode
+            const char *stops = ch == '"' ? "\"\\" : "'\\";
+            int quoteType = ch;
+            for (;;)
             {
-                if (ch == '\\')
-                { // Handle escape sequences
-                    char next = fgetc(file);
-                    if (next == 'n')
-                        token.lexeme[index++] = '\n';
-                    else if (next == 't')
-                        token.lexeme[index++] = '\t';
-                    else if (next == '\\')
-                        token.lexeme[index++] = '\\';
-                    else if (next == '"')
-                        token.lexeme[index++] = '"';
-                    else if (next == '\'')
-                        token.lexeme[index++] = '\'';
-                    else
-                        token.lexeme[index++] = next;
-                }
-                else
-                {
-                    token.lexeme[index++] = ch;
-                }
+                lexer->pos = scan_until(src, lexer->pos, lexer->len, stops, &lexer->line);
+                if ((ch = peek(lexer, 0)) != '\\')
+                    break;
+                lexer->pos += peek(lexer, 1) != EOF ? 2 : 1;
             }
-
-            token.lexeme[index] = '\0';
-            token.type = TOKEN_STRING;
+            Token token = make_token(lexer, TOKEN_STRING, start + 1, lexer->pos, line);
+            if (ch == quoteType)
+                lexer->pos++; // Consume closing quote
             return token;
         }
+
         if (ch == '/')
         {
-            char next = fgetc(file);
+            int next = peek(lexer, 0);
 
             if (next == '/')
             {
-                // Single-line comment
-                while ((ch = fgetc(file)) != '\n' && ch != EOF)
-                    ;
-                return get_next_token(file);
+                // Single-line comment, the newline is counted by the whitespace skip
+                lexer->pos = scan_until(src, lexer->pos, lexer->len, "\n", &lexer->line);
+                continue;
             }
             else if (next == '*')
             {
                 // Multi-line comment
-                while ((ch = fgetc(file)) != EOF)
+                lexer->pos++;
+                while ((lexer->pos = scan_until(src, lexer->pos, lexer->len, "*", &lexer->line)) < lexer->len)
                 {
-                    if (ch == '*' && fgetc(file) == '/')
+                    lexer->pos++;
+                    if (peek(lexer, 0) == '/')
                     {
+                        lexer->pos++;
                         break;
                     }
                 }
-                return get_next_token(file);
-            }
-            else
-            {
-                ungetc(next, file);
-                token.lexeme[0] = '/';
-                token.lexeme[1] = '\0';
-                token.type = TOKEN_OPERATOR;
-                return token;
+                continue;
             }
+
+            return make_token(lexer, TOKEN_OPERATOR, start, lexer->pos, line);
         }
 
         if (ch == '=' || ch == '!' || ch == '<' || ch == '>' || ch == '&' || ch == '|')
         {
-            token.lexeme[0] = ch;
-            token.lexeme[1] = '\0';
-
-            char next = fgetc(file);
+            int next = peek(lexer, 0);
             if ((ch == '=' && next == '=') || (ch == '!' && next == '=') ||
                 (ch == '<' && next == '=') || (ch == '>' && next == '=') ||
                 (ch == '&' && next == '&') || (ch == '|' && next == '|'))
             {
-                token.lexeme[1] = next;
-                token.lexeme[2] = '\0';
+                lexer->pos++;
 
-                if ((ch == '=' && next == '=') || (ch == '!' && next == '='))
-                {
-                    // Check for triple equals (===) or !==
-                    char next2 = fgetc(file);
-                    if (next2 == '=')
-                    {
-                        token.lexeme[2] = next2;
-                        token.lexeme[3] = '\0';
-                    }
-                    else
-                    {
-                        ungetc(next2, file);
-                    }
-                }
-            }
-            else
-            {
-                ungetc(next, file);
+                // Check for triple equals (===) or !==
+                if ((ch == '=' || ch == '!') && peek(lexer, 0) == '=')
+                    lexer->pos++;
             }
 
-            token.type = TOKEN_OPERATOR;
-            return token;
+            return make_token(lexer, TOKEN_OPERATOR, start, lexer->pos, line);
         }
 
-        if (ch == '*' && peek(file) == '*')
-        {
-            advance(file);
-            advance(file);
-            return (Token){TOKEN_OPERATOR, "EXPONENTIATION", line};
-        }
-        if (ch == '?' && peek(file) == '?')
-        {
-            advance(file);
-            advance(file);
-            return (Token){TOKEN_OPERATOR, "NULLISH_COALESCING", line};
-        }
-        if (ch == '?' && peek(file) == '.')
+        if ((ch == '*' && peek(lexer, 0) == '*') ||  // **
+            (ch == '?' && peek(lexer, 0) == '?') ||  // ??
+            (ch == '?' && peek(lexer, 0) == '.'))    // ?.
         {
-            advance(file);
-            advance(file);
-            return (Token){TOKEN_OPERATOR, "OPTIONAL_CHAINING", line};
+            lexer->pos++;
+            return make_token(lexer, TOKEN_OPERATOR, start, lexer->pos, line);
         }
 
-        if (ch == '/' && peek(file) == '*')
+        if (ch && strchr("+-*", ch))
         {
-            advance(file); // Consume '/'
-            advance(file); // Consume '*'
-            while (ch != '\0' && !(ch == '*' && peek(file) == '/'))
-            {
-                advance(file);
-            }
-            if (ch == '*')
-            {
-                advance(file); // Consume '*'
-                advance(file); // Consume '/'
-            }
-            return (Token){TOKEN_COMMENT, "MULTI_LINE_COMMENT", line};
+            return make_token(lexer, TOKEN_OPERATOR, start, lexer->pos, line);
         }
-
-        if (strchr("+-*/=<>!&|", ch))
+        else if (ch && strchr(";,.(){}[]", ch))
         {
-            // Handle operators
-            token.lexeme[0] = ch;
-            token.lexeme[1] = '\0';
-            token.type = TOKEN_OPERATOR;
-
-            // Check for two-character operators (e.g., `==`, `!=`, `&&`, `||`)
-            char next = fgetc(file);
-            if ((ch == '=' && (next == '=')) || // ==
-                (ch == '!' && next == '=') ||   // !=
-                (ch == '&' && next == '&') ||   // &&
-                (ch == '|' && next == '|'))     // ||
-            {
-                token.lexeme[1] = next;
-                token.lexeme[2] = '\0';
-            }
-            else
-            {
-                ungetc(next, file); // Put back if not a double operator
-            }
-            return token;
-        }
-        else if (strchr(";,.(){}[]", ch))
-        {
-            // Handle punctuation
-            token.lexeme[0] = ch;
-            token.lexeme[1] = '\0';
-            // if it is '{' or '}' then its type should be TOKEN_PARENTHESES and if it is ';' its type should be TOKEN_SEMICOLON
+            // '{' and '}' are TOKEN_PARENTHESES, ';' is TOKEN_SEMICOLON
+            TokenType type = TOKEN_PUNCTUATION;
             if (ch == '{' || ch == '}')
-            {
-                token.type = TOKEN_PARENTHESES;
-            }
+                type = TOKEN_PARENTHESES;
             else if (ch == ';')
-            {
-                token.type = TOKEN_SEMICOLON;
-            }
-            else
-            {
-                token.type = TOKEN_PUNCTUATION;
-            }
-            return token;
+                type = TOKEN_SEMICOLON;
+            return make_token(lexer, type, start, lexer->pos, line);
         }
 
-        token.type = TOKEN_ERROR;
-        sprintf(token.lexeme, "Unknown: %c", ch);
-        return token;
+        return make_token(lexer, TOKEN_ERROR, start, lexer->pos, line);
     }
 
-    return (Token){TOKEN_EOF, "EOF", line};
+    return make_token(lexer, TOKEN_EOF, lexer->len, lexer->len, lexer->line);
 }
\ No newline at end of file
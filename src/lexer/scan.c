@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+typedef size_t (*SpaceKernel)(const char *, size_t, size_t, int *);
+typedef size_t (*IdentKernel)(const char *, size_t, size_t);
+typedef size_t (*UntilKernel)(const char *, size_t, size_t, const char *, int *);
+
+/* ---------- Scalar kernels ---------- */
+
+static int is_space_byte(unsigned char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static int is_ident_byte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+// Expand a 1-4 byte stop string into exactly four bytes
+static void stop_bytes(const char *stops, unsigned char out[4])
+{
+    size_t n = strlen(stops);
+    for (size_t i = 0; i < 4; i++)
+        out[i] = (unsigned char)stops[i < n ? i : 0];
+}
+
+static size_t space_scalar(const char *src, size_t pos, size_t len, int *lines)
+{
+    for (; pos < len && is_space_byte((unsigned char)src[pos]); pos++)
+    {
+        if (src[pos] == '\n')
+            (*lines)++;
+    }
+    return pos;
+}
+
+static size_t ident_scalar(const char *src, size_t pos, size_t len)
+{
+    while (pos < len && is_ident_byte((unsigned char)src[pos]))
+        pos++;
+    return pos;
+}
+
+static size_t until_scalar(const char *src, size_t pos, size_t len, const char *stops, int *lines)
+{
+    unsigned char b[4];
+    stop_bytes(stops, b);
+
+    for (; pos < len; pos++)
+    {
+        unsigned char c = (unsigned char)src[pos];
+        if (c == b[0] || c == b[1] || c == b[2] || c == b[3])
+            break;
+        if (c == '\n')
+            (*lines)++;
+    }
+    return pos;
+}
+
+#ifdef SCAN_X86
+
+/* ---------- SSE2 kernels (16 bytes per step) ---------- */
+
+// Bytes in [lo, hi]; bytes >= 0x80 compare negative and never match
+static inline __m128i in_range16(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)(lo - 1))),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8((char)(hi + 1))));
+}
+
+static inline __m128i space_mask16(__m128i v)
+{
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                        in_range16(v, '\t', '\r'));
+}
+
+static inline __m128i ident_mask16(__m128i v)
+{
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_or_si128(_mm_or_si128(in_range16(lower, 'a', 'z'),
+                                     in_range16(v, '0', '9')),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+
+static inline int newlines_before(unsigned nl_mask, unsigned stop)
+{
+    return __builtin_popcount(nl_mask & ((1u << stop) - 1));
+}
+
+static size_t space_sse2(const char *src, size_t pos, size_t len, int *lines)
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (pos + 16 <= len)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + pos));
+        unsigned other = ~(unsigned)_mm_movemask_epi8(space_mask16(v)) & 0xFFFFu;
+        unsigned nls = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        if (other)
+        {
+            unsigned stop = (unsigned)__builtin_ctz(other);
+            *lines += newlines_before(nls, stop);
+            return pos + stop;
+        }
+        *lines += __builtin_popcount(nls);
+        pos += 16;
+    }
+    return space_scalar(src, pos, len, lines);
+}
+
+static size_t ident_sse2(const char *src, size_t pos, size_t len)
+{
+    while (pos + 16 <= len)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + pos));
+        unsigned other = ~(unsigned)_mm_movemask_epi8(ident_mask16(v)) & 0xFFFFu;
+        if (other)
+            return pos + (unsigned)__builtin_ctz(other);
+        pos += 16;
+    }
+    return ident_scalar(src, pos, len);
+}
+
+static size_t until_sse2(const char *src, size_t pos, size_t len, const char *stops, int *lines)
+{
+    unsigned char b[4];
+    stop_bytes(stops, b);
+
+    const __m128i s0 = _mm_set1_epi8((char)b[0]), s1 = _mm_set1_epi8((char)b[1]);
+    const __m128i s2 = _mm_set1_epi8((char)b[2]), s3 = _mm_set1_epi8((char)b[3]);
+    const __m128i nl = _mm_set1_epi8('\n');
+
+    while (pos + 16 <= len)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + pos));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, s0), _mm_cmpeq_epi8(v, s1)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, s2), _mm_cmpeq_epi8(v, s3)));
+        unsigned stop_mask = (unsigned)_mm_movemask_epi8(hit);
+        unsigned nls = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        if (stop_mask)
+        {
+            unsigned stop = (unsigned)__builtin_ctz(stop_mask);
+            *lines += newlines_before(nls, stop);
+            return pos + stop;
+        }
+        *lines += __builtin_popcount(nls);
+        pos += 16;
+    }
+    return until_scalar(src, pos, len, stops, lines);
+}
+
+/* ---------- AVX2 kernels (32 bytes per step) ---------- */
+
+#define AVX2_TARGET __attribute__((target("avx2,popcnt")))
+
+AVX2_TARGET static inline __m256i in_range32(__m256i v, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(hi + 1)), v));
+}
+
+AVX2_TARGET static size_t space_avx2(const char *src, size_t pos, size_t len, int *lines)
+{
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    while (pos + 32 <= len)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + pos));
+        __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, sp), in_range32(v, '\t', '\r'));
+        unsigned other = ~(unsigned)_mm256_movemask_epi8(space);
+        unsigned nls = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        if (other)
+        {
+            unsigned stop = (unsigned)__builtin_ctz(other);
+            *lines += newlines_before(nls, stop);
+            return pos + stop;
+        }
+        *lines += __builtin_popcount(nls);
+        pos += 32;
+    }
+    return space_sse2(src, pos, len, lines);
+}
+
+AVX2_TARGET static size_t ident_avx2(const char *src, size_t pos, size_t len)
+{
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i underscore = _mm256_set1_epi8('_');
+    while (pos + 32 <= len)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + pos));
+        __m256i lower = _mm256_or_si256(v, case_bit);
+        __m256i ident = _mm256_or_si256(_mm256_or_si256(in_range32(lower, 'a', 'z'),
+                                                        in_range32(v, '0', '9')),
+                                        _mm256_cmpeq_epi8(v, underscore));
+        unsigned other = ~(unsigned)_mm256_movemask_epi8(ident);
+        if (other)
+            return pos + (unsigned)__builtin_ctz(other);
+        pos += 32;
+    }
+    return ident_sse2(src, pos, len);
+}
+
+AVX2_TARGET static size_t until_avx2(const char *src, size_t pos, size_t len, const char *stops, int *lines)
+{
+    unsigned char b[4];
+    stop_bytes(stops, b);
+
+    const __m256i s0 = _mm256_set1_epi8((char)b[0]), s1 = _mm256_set1_epi8((char)b[1]);
+    const __m256i s2 = _mm256_set1_epi8((char)b[2]), s3 = _mm256_set1_epi8((char)b[3]);
+    const __m256i nl = _mm256_set1_epi8('\n');
+
+    while (pos + 32 <= len)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + pos));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, s0), _mm256_cmpeq_epi8(v, s1)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(v, s2), _mm256_cmpeq_epi8(v, s3)));
+        unsigned stop_mask = (unsigned)_mm256_movemask_epi8(hit);
+        unsigned nls = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        if (stop_mask)
+        {
+            unsigned stop = (unsigned)__builtin_ctz(stop_mask);
+            *lines += newlines_before(nls, stop);
+            return pos + stop;
+        }
+        *lines += __builtin_popcount(nls);
+        pos += 32;
+    }
+    return until_sse2(src, pos, len, stops, lines);
+}
+
+#endif // SCAN_X86
+
+/* ---------- Dispatch ---------- */
+
+static SpaceKernel space_kernel = space_scalar;
+static IdentKernel ident_kernel = ident_scalar;
+static UntilKernel until_kernel = until_scalar;
+static const char *kernel_name = "scalar";
+static int selected = 0;
+
+void scan_init(void)
+{
+    if (selected)
+        return;
+    selected = 1;
+
+    // JSCC_SCAN=scalar|sse2 forces a narrower kernel set (for benchmarking)
+    const char *force = getenv("JSCC_SCAN");
+    if (force && !strcmp(force, "scalar"))
+        return;
+
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        space_kernel = space_sse2;
+        ident_kernel = ident_sse2;
+        until_kernel = until_sse2;
+        kernel_name = "sse2";
+    }
+    if (__builtin_cpu_supports("avx2") && !(force && !strcmp(force, "sse2")))
+    {
+        space_kernel = space_avx2;
+        ident_kernel = ident_avx2;
+        until_kernel = until_avx2;
+        kernel_name = "avx2";
+    }
+#endif
+}
+
+const char *scan_kernel_name(void)
+{
+    return kernel_name;
+}
+
+size_t scan_space(const char *src, size_t pos, size_t len, int *lines)
+{
+    return space_kernel(src, pos, len, lines);
+}
+
+size_t scan_ident(const char *src, size_t pos, size_t len)
+{
+    return ident_kernel(src, pos, len);
+}
+
+size_t scan_until(const char *src, size_t pos, size_t len, const char *stops, int *lines)
+{
+    return until_kernel(src, pos, len, stops, lines);
+}
@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "../../include/token_stream.h"
+
+/* ---------- SPSC queue ---------- */
+
+#define QUEUE_SIZE 4096 // power of two
+#define CACHE_LINE 64
+
+// head and tail sit on their own cache lines so the two threads do not
+// false-share. Each index is written by one side only.
+struct SpscQueue {
+    _Alignas(CACHE_LINE) atomic_size_t tail; // next slot the producer fills
+    _Alignas(CACHE_LINE) atomic_size_t head; // next slot the consumer reads
+    _Alignas(CACHE_LINE) Token slots[QUEUE_SIZE];
+};
+
+static void queue_push(SpscQueue *q, Token token)
+{
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    while (tail - atomic_load_explicit(&q->head, memory_order_acquire) == QUEUE_SIZE)
+        sched_yield();
+    q->slots[tail & (QUEUE_SIZE - 1)] = token;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
+
+static Token queue_pop(SpscQueue *q)
+{
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    while (atomic_load_explicit(&q->tail, memory_order_acquire) == head)
+        sched_yield();
+    Token token = q->slots[head & (QUEUE_SIZE - 1)];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return token;
+}
+
+static void *produce(void *arg)
+{
+    TokenStream *ts = arg;
+    Token token;
+    do
+    {
+        token = lexer_next(ts->lexer);
+        if (ts->observer)
+            ts->observer(&token, ts->lexer->src, ts->observer_data);
+        queue_push(ts->queue, token);
+    } while (token.type != TOKEN_EOF);
+    return NULL;
+}
+
+/* ---------- Stream ---------- */
+
+void token_stream_init(TokenStream *ts, Lexer *lexer, TokenObserver observer, void *data)
+{
+    ts->lexer = lexer;
+    ts->head = 0;
+    ts->count = 0;
+    ts->at_eof = 0;
+    ts->observer = observer;
+    ts->observer_data = data;
+    ts->queue = NULL;
+}
+
+int token_stream_start_thread(TokenStream *ts)
+{
+    // The lexer must not have been touched by this thread yet
+    if (ts->queue || ts->count || ts->at_eof)
+        return -1;
+
+    SpscQueue *q = aligned_alloc(CACHE_LINE, sizeof(SpscQueue));
+    if (!q)
+        return -1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+
+    ts->queue = q;
+    ts->lexer->defer_atoms = 1;
+    if (pthread_create(&ts->producer, NULL, produce, ts) != 0)
+    {
+        ts->lexer->defer_atoms = 0;
+        ts->queue = NULL;
+        free(q);
+        return -1;
+    }
+    return 0;
+}
+
+// Pull the next token from the lexer or the producer thread. The atom is
+// only needed for tokens the parser will see.
+static Token next_token(TokenStream *ts, int want_atom)
+{
+    if (ts->at_eof)
+        return ts->eof;
+
+    Token token;
+    if (ts->queue)
+    {
+        token = queue_pop(ts->queue);
+        if (want_atom && token.type != TOKEN_EOF)
+            token.atom = intern(ts->lexer->src + token.offset, token.length);
+    }
+    else
+    {
+        token = lexer_next(ts->lexer);
+        if (ts->observer)
+            ts->observer(&token, ts->lexer->src, ts->observer_data);
+    }
+
+    if (token.type == TOKEN_EOF)
+    {
+        ts->at_eof = 1;
+        ts->eof = token;
+    }
+    return token;
+}
+
+Token token_stream_fill(TokenStream *ts, unsigned k)
+{
+    if (k >= TS_LOOKAHEAD)
+    {
+        printf("Internal Error: parser looked %u tokens ahead\n", k);
+        exit(1);
+    }
+    while (ts->count <= k)
+    {
+        ts->ring[(ts->head + ts->count) & (TS_RING_SIZE - 1)] = next_token(ts, 1);
+        ts->count++;
+    }
+    return ts->ring[(ts->head + k) & (TS_RING_SIZE - 1)];
+}
+
+void token_stream_drain(TokenStream *ts)
+{
+    // Nothing drained reaches the parser, so skip interning
+    ts->lexer->defer_atoms = 1;
+    while (!ts->at_eof)
+        next_token(ts, 0);
+}
+
+void token_stream_close(TokenStream *ts)
+{
+    token_stream_drain(ts);
+    if (ts->queue)
+    {
+        pthread_join(ts->producer, NULL);
+        free(ts->queue);
+        ts->queue = NULL;
+    }
+    ts->lexer->defer_atoms = 0;
+}
@@ -1,18 +1,32 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+#include "../include/context.h"
 #include "../include/lexer.h"
 #include "../include/parser.h"
 #include "../include/semantic.h"
 #include "../include/ir.h"
 #include "../include/cfg.h"
 #include "../include/opt.h"
+#include "../include/ssa.h"
+#include "../include/pass.h"
+#include "../include/stats.h"
 #include "../include/codegen.h"
 #include "../include/qbe_codegen.h"
+#include "../include/x86.h"
+#include "../include/vm.h"
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+
+// Default QBE binary, set by the Makefile
+#ifndef QBE_PATH
+#define QBE_PATH "./qbe"
+#endif
 
 void ensure_tmp_dir(void) {
 #ifdef _WIN32
@@ -22,12 +36,186 @@ void ensure_tmp_dir(void) {
 #endif
 }
 
+typedef struct {
+    FILE *file;
+    int debug;
+} TokenLog;
+
+// Writes each token to tokens.txt (and stdout with -d)
+static void log_token(const Token *token, const char *src, void *data)
+{
+    TokenLog *log = data;
+    const char *tokenType =
+        token->type == TOKEN_IDENTIFIER ? "TOKEN_IDENTIFIER" : token->type == TOKEN_KEYWORD   ? "TOKEN_KEYWORD"
+                                                           : token->type == TOKEN_NUMBER      ? "TOKEN_NUMBER"
+                                                           : token->type == TOKEN_STRING      ? "TOKEN_STRING"
+                                                           : token->type == TOKEN_OPERATOR    ? "TOKEN_OPERATOR"
+                                                           : token->type == TOKEN_PARENTHESES ? "TOKEN_PARENTHESES"
+                                                           : token->type == TOKEN_SEMICOLON   ? "TOKEN_SEMICOLON"
+                                                           : token->type == TOKEN_PUNCTUATION ? "TOKEN_PUNCTUATION"
+                                                           : token->type == TOKEN_COMMENT     ? "TOKEN_COMMENT"
+                                                           : token->type == TOKEN_BOOLEAN     ? "TOKEN_BOOLEAN"
+                                                           : token->type == TOKEN_ERROR       ? "TOKEN_ERROR"
+                                                                                              : "TOKEN_EOF";
+    if (log->debug)
+    {
+        printf("Token: %-17s | Lexeme: %-15.*s | Line: %d\n", tokenType,
+               (int)token->length, token_text(src, *token), token->line);
+    }
+
+    if (token->type != TOKEN_EOF)
+    {
+        fprintf(log->file, "    {%s, \"%.*s\", %d},\n", tokenType,
+                (int)token->length, token_text(src, *token), token->line);
+    }
+}
+
+// JSCC_QBE, else ./qbe when present, else qbe from PATH
+static const char *qbe_path(void)
+{
+    const char *env = getenv("JSCC_QBE");
+    if (env && *env)
+        return env;
+    return access(QBE_PATH, X_OK) == 0 ? QBE_PATH : "qbe";
+}
+
+// The IL stays in memory: it is piped into qbe, and the assembly qbe
+// prints is piped into gcc, which assembles and links ./out
+static int build_with_qbe(IRInstr *ir)
+{
+    char *il, *assembly = NULL; // stays NULL if qbe never starts
+    size_t il_len, assembly_len;
+    stats_begin("qbe-emit");
+    FILE *il_stream = open_memstream(&il, &il_len);
+    if (!il_stream)
+    {
+        perror("open_memstream");
+        return 1;
+    }
+    qbe_codegen_ir(ir, il_stream);
+    fclose(il_stream);
+    stats_end();
+
+    char *qbe_argv[] = {(char *)qbe_path(), "-", NULL};
+    char *cc_argv[] = {"gcc", "-x", "assembler", "-", "-o", "out", NULL};
+    int failed = stats_exec_io("qbe", qbe_argv, il, il_len, &assembly, &assembly_len) != 0;
+    free(il);
+    if (failed)
+    {
+        free(assembly);
+        printf("Error: qbe failed\n");
+        return 1;
+    }
+    // One gcc run both assembles and links, so the object never hits disk
+    failed = stats_exec_io("assemble+link", cc_argv, assembly, assembly_len, NULL, NULL) != 0;
+    free(assembly);
+    if (failed)
+    {
+        printf("Error: assembling or linking failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+// C backend: C source from the AST, compiled by the host compiler, whose
+// vectorizer gets the counted loops
+static int build_with_c(const Ast *ast)
+{
+    stats_begin("c-emit");
+    codegen_c(ast, "./tmp/out.c");
+    stats_end();
+
+    char *cc_argv[] = {"gcc", "-O2", "-fwrapv", "-w", "./tmp/out.c", "-o", "out", NULL};
+    if (stats_exec("cc", cc_argv) != 0)
+    {
+        printf("Error: compiling the generated C failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Native backend: machine code straight from the IR, no tools
+static void compile_native(X86Image *image)
+{
+    ssa_destruct(); // phis become copies; a no-op when SSA never ran
+    x86_codegen(image);
+}
+
+static int build_native(void)
+{
+    X86Image image;
+    stats_begin("x86");
+    compile_native(&image);
+    int failed = x86_write_elf(&image, "out") != 0;
+    x86_free(&image);
+    stats_end();
+    return failed;
+}
+
+// --run: same code, called in-process instead of written to ./out.
+// Returns the program's status, or 1 if it could not be mapped.
+static int run_native(void)
+{
+    X86Image image;
+    stats_begin("x86");
+    compile_native(&image);
+    stats_end();
+    stats_end(); // compile
+
+    printf("Running program:\n");
+    int status;
+    stats_begin("run");
+    int failed = x86_jit_run(&image, &status) != 0;
+    stats_end();
+    x86_free(&image);
+    return failed ? 1 : status;
+}
+
+// Bytecode interpreter: no machine code at all
+static int run_vm(int debug)
+{
+    VMProgram prog;
+    stats_begin("vm");
+    ssa_destruct();
+    vm_compile(&prog);
+    stats_end();
+    stats_end(); // compile
+    if (debug)
+    {
+        printf("\n=== Bytecode ===\n");
+        vm_print(&prog);
+    }
+
+    printf("Running program:\n");
+    stats_begin("run");
+    int status = vm_run(&prog);
+    stats_end();
+    vm_free(&prog);
+    return status;
+}
+
+static void finish_stats(int show_stats, const char *trace_path)
+{
+    if (show_stats)
+        stats_report(stdout);
+    if (trace_path && stats_write_trace(trace_path) == 0)
+        printf("Trace written to %s\n", trace_path);
+}
+
 int main(int argc, char *argv[])
 {
     ensure_tmp_dir();
 
     int debug = 0;
     int stop_at_qbe = 0;
+    int lex_thread = 0;
+    int pass_stats = 0;
+    int time_passes = 0;
+    int show_stats = 0;
+    const char *trace_path = NULL;
+    int opt_level = 2;
+    const char *backend = NULL;
+    int jit = 0;
 
     for (int i = 1; i < argc; i++)
     {
@@ -35,15 +223,66 @@ int main(int argc, char *argv[])
             debug = 1;
         if (!strcmp(argv[i], "-q"))
             stop_at_qbe = 1;
+        if (!strcmp(argv[i], "--lex-thread"))
+            lex_thread = 1;
+        if (!strcmp(argv[i], "--pass-stats"))
+            pass_stats = 1;
+        if (!strcmp(argv[i], "--time-passes"))
+            time_passes = 1;
+        if (!strcmp(argv[i], "--stats"))
+            show_stats = 1;
+        if (!strncmp(argv[i], "--trace=", 8))
+            trace_path = argv[i] + 8;
+        if (argv[i][0] == '-' && argv[i][1] == 'O')
+        {
+            opt_level = atoi(argv[i] + 2);
+            pass_set_level(opt_level);
+        }
+        if (!strcmp(argv[i], "--run"))
+            jit = 1;
+        if (!strncmp(argv[i], "--backend=", 10))
+            backend = argv[i] + 10;
+        if (!strncmp(argv[i], "--unroll=", 9))
+            pass_set_unroll(atoi(argv[i] + 9));
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strncmp(argv[i], "-fpass=", 7))
+            pass_override(argv[i] + 7);
+    }
+    // Unoptimized builds default to the fast native path
+    if (!backend)
+        backend = opt_level == 0 || jit ? "x86" : "qbe";
+    if (strcmp(backend, "x86") && strcmp(backend, "qbe") && strcmp(backend, "vm") &&
+        strcmp(backend, "c"))
+    {
+        printf("Error: unknown backend '%s' (expected qbe, x86, vm or c)\n", backend);
+        return 1;
     }
+    int use_x86 = !strcmp(backend, "x86");
+    int use_vm = !strcmp(backend, "vm");
+    int use_c = !strcmp(backend, "c");
+    if (jit && !use_x86)
+    {
+        printf("Error: --run needs the x86 backend (vm always runs in-process)\n");
+        return 1;
+    }
+
     if (argc < 2)
     {
         printf("Usage: %s <filename>\n", argv[0]);
         return 1;
     }
 
-    FILE *file = fopen(argv[1], "r");
-    if (!file)
+    if (show_stats || trace_path)
+        stats_enable();
+    stats_begin("compile");
+
+    CompileContext ctx;
+    context_init(&ctx);
+
+    Lexer lexer;
+    if (lexer_open(&lexer, argv[1]) != 0)
     {
         printf("Error opening file: %s\n", argv[1]);
         return 1;
@@ -53,7 +292,7 @@ int main(int argc, char *argv[])
     if (!outputFile)
     {
         printf("Error opening output file.\n");
-        fclose(file);
+        lexer_close(&lexer);
         return 1;
     }
 
@@ -63,70 +302,36 @@ int main(int argc, char *argv[])
         printf("Token: ...\n");
     }
 
-    Token tokens[1000];
-    int tokenCount = 0;
-    Token token;
-
-    do
-    {
-        token = get_next_token(file);
-        tokens[tokenCount++] = token;
-
-        const char *tokenType =
-            token.type == TOKEN_IDENTIFIER ? "TOKEN_IDENTIFIER" : token.type == TOKEN_KEYWORD   ? "TOKEN_KEYWORD"
-                                                              : token.type == TOKEN_NUMBER      ? "TOKEN_NUMBER"
-                                                              : token.type == TOKEN_STRING      ? "TOKEN_STRING"
-                                                              : token.type == TOKEN_OPERATOR    ? "TOKEN_OPERATOR"
-                                                              : token.type == TOKEN_PARENTHESES ? "TOKEN_PARENTHESES"
-                                                              : token.type == TOKEN_SEMICOLON   ? "TOKEN_SEMICOLON"
-                                                              : token.type == TOKEN_PUNCTUATION ? "TOKEN_PUNCTUATION"
-                                                              : token.type == TOKEN_COMMENT     ? "TOKEN_COMMENT"
-                                                              : token.type == TOKEN_BOOLEAN     ? "TOKEN_BOOLEAN"
-                                                              : token.type == TOKEN_ERROR       ? "TOKEN_ERROR"
-                                                                                                : "TOKEN_EOF";
-        if (debug)
-        {            
-            printf("Token: %-17s | Lexeme: %-15s | Line: %d\n", tokenType, token.lexeme, token.line);
-        }
-            
-        if (token.type != TOKEN_EOF)
-        {
-            fprintf(outputFile, "    {%s, \"%s\", %d},\n", tokenType, token.lexeme, token.line);
-        }
-    } while (token.type != TOKEN_EOF);
-    fprintf(outputFile, "};\n");
-    fclose(outputFile);
-    fclose(file);
-
-    // Now parse and generate IR from tokens[]
-    // Parse entire program
-    int index = 0;
+    // Tokens are logged as the lexer produces them and parsed on demand;
+    // the whole token array never exists
+    TokenLog log = {outputFile, debug};
+    TokenStream stream;
+    token_stream_init(&stream, &lexer, log_token, &log);
+    if (lex_thread && token_stream_start_thread(&stream) != 0)
+        printf("Warning: could not start lexer thread, lexing inline\n");
 
-    ASTNode *program = create_node(AST_BLOCK, NULL);
-    program->body = malloc(sizeof(ASTNode *) * 256);
-    program->body_size = 0;
+    stats_begin("lex+parse");
+    parser_init(&ctx.ast);
+    parse_program(&stream);
 
-    while (tokens[index].type != TOKEN_ERROR &&
-           tokens[index].type != TOKEN_EOF )
-    {
+    // Parsing stops at the first TOKEN_ERROR; still log the rest
+    token_stream_close(&stream);
+    fprintf(outputFile, "};\n");
+    fclose(outputFile);
 
-        ASTNode *stmt = parse_statement(tokens, &index);
-        if (stmt)
-        {
-            program->body[program->body_size++] = stmt;
-        }
-    }
+    // Atoms own their text, the source buffer is no longer needed
+    lexer_close(&lexer);
+    stats_end();
 
     // Semantic analysis (ONE PASS)
-    semantic_analyze(program);
+    stats_begin("semantic");
+    semantic_analyze(&ctx.ast);
+    stats_end();
 
-    // Constant Folding
-    program = opt_fold_constants(program);
     if (debug)
     {
-        printf("\n=== After Constant Folding ===\n");
-        // printf(program);
-        print_ast(program, 0);
+        printf("\n=== AST ===\n");
+        print_ast(&ctx.ast, ctx.ast.root, 0);
     }
     // IR/TAC Generation
     if (debug)
@@ -134,38 +339,80 @@ int main(int argc, char *argv[])
         printf("\n===IR / TAC ===\n");
     }
     
-    ir_generate(program);
+    stats_begin("irgen");
+    ir_generate(&ctx.ast);
+    stats_end();
+    int ir_count;
+    IRInstr *ir = ir_get_all(&ir_count);
+    if (debug)
+        ir_print();
 
     // Control Flow Graph Construction
     if(debug)
     {
         printf("\n=== CFG ===\n");
     }
-    cfg_build(program);
+    stats_begin("cfg");
+    cfg_build(ir, ir_count);
+    stats_end();
     if(debug)
         cfg_print();
 
-    // Dead Code Elimination
-    opt_dead_code_elimination();
+    // SSA construction and optimizations, as selected by -O / -fpass=
+    stats_begin("passes");
+    pass_run_all(time_passes, pass_stats);
+    stats_end();
+
+    ir = ir_get_all(&ir_count);
+    if (debug)
+    {
+        printf("\n=== Optimized IR ===\n");
+        ir_print();
+    }
 
     //     /* =========================
     //    QBE Backend
     //    ========================= */
-    int ir_count;
-    IRInstr *ir = ir_get_all(&ir_count);
-
-    qbe_codegen_ir(ir, ir_count, "./tmp/out.qbe");
 
     if (stop_at_qbe)
     {
+        FILE *il_file = fopen("./tmp/out.qbe", "wb");
+        if (!il_file)
+        {
+            perror("fopen");
+            printf("Failed to open output QBE file: tmp/out.qbe\n");
+            return 1;
+        }
+        stats_begin("qbe-emit");
+        qbe_codegen_ir(ir, il_file);
+        fclose(il_file);
+        stats_end();
+
         printf("Generated QBE IR → tmp/out.qbe\n");
+        context_free(&ctx);
+        stats_end();
+        finish_stats(show_stats, trace_path);
         return 0;
     }
-    system("./qbe tmp/out.qbe > tmp/out.s");
-    system("gcc tmp/out.s -o out");
 
-    printf("Running program:\n");
-    system("./out");
+    // In-process runs report the program's own exit status
+    int status = 0;
+    if (use_vm)
+        status = run_vm(debug);
+    else if (jit)
+        status = run_native();
+    else
+    {
+        if (use_c ? build_with_c(&ctx.ast) : use_x86 ? build_native() : build_with_qbe(ir))
+            return 1;
+        stats_end();
+
+        printf("Running program:\n");
+        char *run_argv[] = {"./out", NULL};
+        status = stats_exec("run", run_argv);
+        if (status < 0)
+            status = 1;
+    }
 
     // printf("\nGenerated TAC:\n");
     // for (int i = 0; i < astCount; i++) {
@@ -175,9 +422,8 @@ int main(int argc, char *argv[])
     // printf("\nSymbol Table:\n");
     // printSymbolTable();
 
-    // for (int i = 0; i < astCount; i++) {
-    //     free_ast(astList[i]);
-    // }
-
-    return 0;
+    // AST, names and block bodies all go in one shot
+    context_free(&ctx);
+    finish_stats(show_stats, trace_path);
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "opt.h"
+
+// Dominator-scoped global value numbering on the SSA form. Walking the
+// dominator tree, each expression is hashed on (opcode, operand leaders);
+// an expression already computed in a dominating block is replaced by
+// the earlier result. Copies and phis whose arguments all agree take
+// the leader of their source, so later uses see through them.
+
+typedef struct {
+    uint32_t op;
+    IROperand lhs, rhs;
+    uint32_t temp; // result; UINT32_MAX marks an empty slot
+} ExprEntry;
+
+static IRInstr *ir;
+static IROperand *leader; // per temporary
+static ExprEntry *table;
+static uint32_t table_mask;
+static uint32_t *undo;    // table slots in insertion order
+static int undo_count = 0;
+
+static IROperand resolve(IROperand v)
+{
+    return v.kind == OPD_TEMP ? leader[v.index] : v;
+}
+
+static int same_operand(IROperand a, IROperand b)
+{
+    return a.kind == b.kind && a.index == b.index;
+}
+
+static int is_commutative(IROp op)
+{
+    return op == IR_ADD || op == IR_MUL || op == IR_EQ || op == IR_NE;
+}
+
+static uint32_t operand_key(IROperand v)
+{
+    return v.kind * 0x9E3779B1u ^ v.index;
+}
+
+// a > b is b < a and a >= b is b <= a; commutative operands are ordered
+static void normalize(uint32_t *op, IROperand *l, IROperand *r)
+{
+    IROperand t;
+    if (*op == IR_GT || *op == IR_GE)
+    {
+        *op = *op == IR_GT ? IR_LT : IR_LE;
+        t = *l, *l = *r, *r = t;
+    }
+    else if (is_commutative(*op) && operand_key(*l) > operand_key(*r))
+        t = *l, *l = *r, *r = t;
+}
+
+static uint32_t hash_expr(uint32_t op, IROperand l, IROperand r)
+{
+    uint32_t h = op * 16777619u;
+    h = (h ^ operand_key(l)) * 16777619u;
+    h = (h ^ operand_key(r)) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+// Returns the slot holding the expression, or the empty slot for it
+static uint32_t find_slot(uint32_t op, IROperand l, IROperand r)
+{
+    uint32_t slot = hash_expr(op, l, r) & table_mask;
+    while (table[slot].temp != UINT32_MAX)
+    {
+        ExprEntry *e = &table[slot];
+        if (e->op == op && same_operand(e->lhs, l) && same_operand(e->rhs, r))
+            break;
+        slot = (slot + 1) & table_mask;
+    }
+    return slot;
+}
+
+// Linear probing entries removed in reverse insertion order can simply
+// be emptied: anything that probed past them was inserted later
+static void pop_scope(int mark)
+{
+    while (undo_count > mark)
+        table[undo[--undo_count]].temp = UINT32_MAX;
+}
+
+static void visit_block(const BasicBlock *b, GvnStats *stats)
+{
+    for (int i = b->first; i < b->end; i++)
+    {
+        IRInstr *in = &ir[i];
+        if (in->op == IR_ASSIGN && in->dst.kind == OPD_TEMP)
+        {
+            leader[in->dst.index] = resolve(in->lhs);
+            in->op = IR_NOP;
+            stats->copies++;
+            continue;
+        }
+
+        if (in->op == IR_PHI)
+        {
+            // Arguments from back edges may not have a leader yet; that
+            // only makes the phi look less redundant than it is
+            IROperand same = {.kind = OPD_NONE};
+            int unique = 1;
+            for (int j = 0; j < in->argc && unique; j++)
+            {
+                IROperand arg = resolve(ir_phi_args(in)[j]);
+                if (same_operand(arg, in->dst))
+                    continue;
+                if (same.kind == OPD_NONE)
+                    same = arg;
+                else if (!same_operand(same, arg))
+                    unique = 0;
+            }
+            if (unique && same.kind != OPD_NONE)
+            {
+                leader[in->dst.index] = same;
+                in->op = IR_NOP;
+                stats->copies++;
+            }
+            continue;
+        }
+
+        if (!IR_IS_BINARY(in->op))
+            continue;
+
+        uint32_t op = in->op;
+        IROperand l = resolve(in->lhs);
+        IROperand r = resolve(in->rhs);
+        // Memory can change between two reads
+        if (l.kind == OPD_VAR || r.kind == OPD_VAR)
+            continue;
+        normalize(&op, &l, &r);
+
+        uint32_t slot = find_slot(op, l, r);
+        if (table[slot].temp != UINT32_MAX)
+        {
+            leader[in->dst.index] = (IROperand){.kind = OPD_TEMP, .index = table[slot].temp};
+            in->op = IR_NOP;
+            stats->redundant++;
+            continue;
+        }
+        table[slot] = (ExprEntry){op, l, r, in->dst.index};
+        undo[undo_count++] = slot;
+    }
+}
+
+void opt_gvn(GvnStats *stats)
+{
+    int ir_count;
+    ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+    int temp_count = ir_temp_count();
+    memset(stats, 0, sizeof(*stats));
+
+    leader = malloc(sizeof(IROperand) * (temp_count + 1));
+    for (int t = 0; t < temp_count; t++)
+        leader[t] = (IROperand){.kind = OPD_TEMP, .index = (uint32_t)t};
+
+    uint32_t size = 64;
+    while (size < (uint32_t)ir_count * 2)
+        size *= 2;
+    table_mask = size - 1;
+    table = malloc(sizeof(ExprEntry) * size);
+    for (uint32_t i = 0; i < size; i++)
+        table[i].temp = UINT32_MAX;
+    undo = malloc(sizeof(uint32_t) * (ir_count + 1));
+    undo_count = 0;
+
+    // Preorder walk of the dominator tree, scoping the table per subtree
+    int *stack = malloc(sizeof(int) * block_count);
+    int *next = calloc(block_count, sizeof(int));
+    int *mark = malloc(sizeof(int) * block_count);
+    int top = 0;
+    stack[top++] = 0;
+    mark[0] = 0;
+    visit_block(cfg_get_block(0), stats);
+    while (top)
+    {
+        BasicBlock *b = cfg_get_block(stack[top - 1]);
+        if (next[b->id] < b->dom_count)
+        {
+            int kid = cfg_dom_children(b)[next[b->id]++];
+            mark[kid] = undo_count;
+            visit_block(cfg_get_block(kid), stats);
+            stack[top++] = kid;
+            continue;
+        }
+        pop_scope(mark[b->id]);
+        top--;
+    }
+
+    // Every remaining use, phi arguments included, reads its leader
+    for (int i = 0; i < ir_count; i++)
+    {
+        IROperand *uses[2];
+        int n = ir_uses(&ir[i], uses);
+        for (int u = 0; u < n; u++)
+            *uses[u] = resolve(*uses[u]);
+        if (ir[i].op == IR_PHI)
+            for (int j = 0; j < ir[i].argc; j++)
+                ir_phi_args(&ir[i])[j] = resolve(ir_phi_args(&ir[i])[j]);
+    }
+
+    free(leader);
+    free(table);
+    free(undo);
+    free(stack);
+    free(next);
+    free(mark);
+}
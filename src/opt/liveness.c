@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <string.h>
+#include "opt.h"
+
+// Liveness one name at a time, walking back from each use that reads a
+// value from outside its block until a defining block. The work is the
+// size of the live ranges, not blocks times names. A phi reads its
+// argument at the end of the matching predecessor.
+
+typedef struct {
+    int block;
+    int pos; // instruction index; phi arguments read at the predecessor's end
+} Site;
+
+// Defs and uses, grouped per name
+typedef struct {
+    int *first; // per name, into sites
+    Site *sites;
+    int *fill;
+} SiteList;
+
+static int (*name_of)(IROperand v);
+static int name_count;
+
+static void site_add(SiteList *list, IROperand v, int block, int pos)
+{
+    int n = name_of(v);
+    if (n < 0)
+        return;
+    if (list->sites)
+        list->sites[list->fill[n]++] = (Site){block, pos};
+    else
+        list->first[n + 1]++;
+}
+
+// First pass counts into first[], second fills sites
+static void scan(SiteList *uses, SiteList *defs)
+{
+    int ir_count;
+    IRInstr *ir = ir_get_all(&ir_count);
+    for (int b = 0; b < cfg_block_count(); b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        if (block->rpo < 0)
+            continue;
+        const int *preds = cfg_preds(block);
+        for (int i = block->first; i < block->end; i++)
+        {
+            IROperand *ops[2];
+            int n = ir_uses(&ir[i], ops);
+            for (int u = 0; u < n; u++)
+                site_add(uses, *ops[u], b, i);
+            for (int k = 0; ir[i].op == IR_PHI && k < ir[i].argc; k++)
+            {
+                const BasicBlock *pred = cfg_get_block(preds[k]);
+                if (pred->rpo >= 0)
+                    site_add(uses, ir_phi_args(&ir[i])[k], pred->id, pred->end);
+            }
+            IROperand *def = ir_def(&ir[i]);
+            if (def)
+                site_add(defs, *def, b, i);
+        }
+    }
+}
+
+static void sites_group(SiteList *list)
+{
+    for (int n = 0; n < name_count; n++)
+        list->first[n + 1] += list->first[n];
+    list->sites = malloc(sizeof(Site) * (list->first[name_count] + 1));
+    list->fill = malloc(sizeof(int) * (name_count + 1));
+    memcpy(list->fill, list->first, sizeof(int) * (name_count + 1));
+}
+
+static void sites_free(SiteList *list)
+{
+    free(list->first);
+    free(list->sites);
+    free(list->fill);
+}
+
+void liveness_build(Liveness *live, int names, int (*name)(IROperand v))
+{
+    name_of = name;
+    name_count = names;
+    int block_count = cfg_block_count();
+
+    SiteList uses = {calloc(names + 1, sizeof(int)), NULL, NULL};
+    SiteList defs = {calloc(names + 1, sizeof(int)), NULL, NULL};
+    scan(&uses, &defs);
+    sites_group(&uses);
+    sites_group(&defs);
+    scan(&uses, &defs);
+
+    live->first = malloc(sizeof(int) * (names + 1));
+    int capacity = 64, count = 0;
+    live->blocks = malloc(sizeof(int) * capacity);
+
+    // Per block, stamped with n + 1 while name n is processed
+    int *def_stamp = calloc(block_count + 1, sizeof(int));
+    int *first_def = malloc(sizeof(int) * (block_count + 1));
+    int *live_stamp = calloc(block_count + 1, sizeof(int));
+    int stack_capacity = 64;
+    int *stack = malloc(sizeof(int) * stack_capacity);
+
+    for (int n = 0; n < names; n++)
+    {
+        live->first[n] = count;
+        for (int d = defs.first[n]; d < defs.first[n + 1]; d++)
+        {
+            Site s = defs.sites[d];
+            if (def_stamp[s.block] != n + 1 || s.pos < first_def[s.block])
+                first_def[s.block] = s.pos;
+            def_stamp[s.block] = n + 1;
+        }
+
+        int top = 0;
+        for (int u = uses.first[n]; u < uses.first[n + 1]; u++)
+        {
+            Site s = uses.sites[u];
+            if (def_stamp[s.block] == n + 1 && first_def[s.block] < s.pos)
+                continue; // reads a def from its own block
+            if (top == stack_capacity)
+                stack = realloc(stack, sizeof(int) * (stack_capacity *= 2));
+            stack[top++] = s.block;
+        }
+
+        while (top > 0)
+        {
+            int b = stack[--top];
+            if (live_stamp[b] == n + 1)
+                continue;
+            live_stamp[b] = n + 1;
+            if (count == capacity)
+                live->blocks = realloc(live->blocks, sizeof(int) * (capacity *= 2));
+            live->blocks[count++] = b;
+
+            BasicBlock *block = cfg_get_block(b);
+            const int *preds = cfg_preds(block);
+            for (int p = 0; p < block->pred_count; p++)
+            {
+                int pred = preds[p];
+                if (cfg_get_block(pred)->rpo < 0 || def_stamp[pred] == n + 1 ||
+                    live_stamp[pred] == n + 1)
+                    continue;
+                if (top == stack_capacity)
+                    stack = realloc(stack, sizeof(int) * (stack_capacity *= 2));
+                stack[top++] = pred;
+            }
+        }
+    }
+    live->first[names] = count;
+
+    free(stack);
+    free(live_stamp);
+    free(first_def);
+    free(def_stamp);
+    sites_free(&uses);
+    sites_free(&defs);
+}
+
+void liveness_free(Liveness *live)
+{
+    free(live->first);
+    free(live->blocks);
+    memset(live, 0, sizeof(*live));
+}
@@ -0,0 +1,686 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "opt.h"
+
+// Loop optimizer on the SSA form: natural loops from back edges,
+// loop-invariant code motion into the preheader, and strength reduction
+// of counter * constant into an additive induction variable.
+
+typedef struct {
+    int header;
+    int preheader; // unique outside predecessor with a single successor, or -1
+    int latch;     // unique back-edge source, or -1
+    int parent;    // enclosing loop, or -1
+} Loop;
+
+// Instruction to splice in front of position `before` when rebuilding
+typedef struct {
+    int before;
+    int seq; // keeps insertions at the same position in creation order
+    IRInstr in;
+} Insertion;
+
+// A header phi i = phi(init, i + step)
+typedef struct {
+    int loop;
+    IROperand init;
+    int32_t step;
+    int increment; // instruction computing i + step
+} BasicIV;
+
+// i * factor, tracked as its own induction variable
+typedef struct {
+    uint32_t iv;   // phi temporary of the basic IV
+    int32_t factor;
+    IROperand value;
+} DerivedIV;
+
+static IRInstr *ir;
+static Loop *loops;
+static int loop_count = 0;
+static int *loop_of;    // innermost loop per block, -1 outside loops
+static int *def_block;  // defining block per temporary (after hoisting)
+static int *def_instr;  // defining instruction per temporary
+
+static Insertion *inserts;
+static int insert_count = 0;
+static int insert_capacity = 0;
+
+static void insert_before(int before, IRInstr in)
+{
+    if (insert_count >= insert_capacity)
+    {
+        insert_capacity = insert_capacity ? insert_capacity * 2 : 64;
+        inserts = realloc(inserts, sizeof(Insertion) * insert_capacity);
+        if (!inserts)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    inserts[insert_count] = (Insertion){before, insert_count, in};
+    insert_count++;
+}
+
+static int in_loop(int block, int loop)
+{
+    for (int l = loop_of[block]; l >= 0; l = loops[l].parent)
+        if (l == loop)
+            return 1;
+    return 0;
+}
+
+static int pred_slot(const BasicBlock *b, int pred)
+{
+    const int *preds = cfg_preds(b);
+    for (int i = 0; i < b->pred_count; i++)
+        if (preds[i] == pred)
+            return i;
+    return -1;
+}
+
+/* ---------- Loop detection ---------- */
+
+// Headers come in RPO, so an enclosing loop is always found first and
+// inner bodies overwrite loop_of with the innermost loop
+static void find_loops(int block_count)
+{
+    int rpo_count;
+    const int *rpo = cfg_rpo(&rpo_count);
+    int *stamp = calloc(block_count, sizeof(int));
+    int *stack = malloc(sizeof(int) * block_count);
+
+    loops = malloc(sizeof(Loop) * (block_count + 1));
+    loop_count = 0;
+    for (int b = 0; b < block_count; b++)
+        loop_of[b] = -1;
+
+    for (int r = 0; r < rpo_count; r++)
+    {
+        BasicBlock *h = cfg_get_block(rpo[r]);
+        const int *preds = cfg_preds(h);
+        int latches = 0, latch = -1;
+        for (int i = 0; i < h->pred_count; i++)
+        {
+            if (cfg_dominates(h->id, preds[i]))
+            {
+                latches++;
+                latch = preds[i];
+            }
+        }
+        if (!latches)
+            continue;
+
+        int id = loop_count++;
+        Loop *loop = &loops[id];
+        *loop = (Loop){h->id, -1, latches == 1 ? latch : -1, loop_of[h->id]};
+
+        // Body: everything that reaches a latch without passing the header
+        int top = 0;
+        stamp[h->id] = id + 1;
+        loop_of[h->id] = id;
+        for (int i = 0; i < h->pred_count; i++)
+        {
+            if (cfg_dominates(h->id, preds[i]) && stamp[preds[i]] != id + 1)
+            {
+                stamp[preds[i]] = id + 1;
+                stack[top++] = preds[i];
+            }
+        }
+        while (top)
+        {
+            BasicBlock *b = cfg_get_block(stack[--top]);
+            loop_of[b->id] = id;
+            const int *bp = cfg_preds(b);
+            for (int i = 0; i < b->pred_count; i++)
+            {
+                if (stamp[bp[i]] != id + 1 && cfg_get_block(bp[i])->rpo >= 0)
+                {
+                    stamp[bp[i]] = id + 1;
+                    stack[top++] = bp[i];
+                }
+            }
+        }
+
+        int outside = -1, count = 0;
+        for (int i = 0; i < h->pred_count; i++)
+        {
+            if (loop_of[preds[i]] != id && !in_loop(preds[i], id))
+            {
+                outside = preds[i];
+                count++;
+            }
+        }
+        if (count == 1 && cfg_get_block(outside)->succ_count == 1)
+            loop->preheader = outside;
+    }
+
+    free(stamp);
+    free(stack);
+}
+
+/* ---------- Invariant code motion ---------- */
+
+// Hoisted code runs even when the loop body would not; QBE's div traps
+static int can_speculate(const IRInstr *in)
+{
+    if (!IR_IS_BINARY(in->op))
+        return 0;
+    if (in->op == IR_DIV)
+        return in->rhs.kind == OPD_INT && in->rhs.imm != 0 && in->rhs.imm != -1;
+    return 1;
+}
+
+// Block holding the operand's value; -1 for immediates, the using
+// block itself for memory (which the loop may change)
+static int operand_block(IROperand v, int user_block)
+{
+    if (v.kind == OPD_TEMP)
+        return def_block[v.index];
+    if (v.kind == OPD_VAR)
+        return user_block;
+    return -1;
+}
+
+// Append to the end of the preheader, ahead of a final jump
+static int preheader_end(int preheader)
+{
+    BasicBlock *p = cfg_get_block(preheader);
+    if (p->end > p->first && ir[p->end - 1].op == IR_GOTO)
+        return p->end - 1;
+    return p->end;
+}
+
+static void hoist_invariants(LoopStats *stats)
+{
+    int rpo_count;
+    const int *rpo = cfg_rpo(&rpo_count);
+
+    // RPO visits definitions before their uses, so operands that were
+    // hoisted already report their new block
+    for (int r = 0; r < rpo_count; r++)
+    {
+        BasicBlock *b = cfg_get_block(rpo[r]);
+        if (loop_of[b->id] < 0)
+            continue;
+
+        for (int i = b->first; i < b->end; i++)
+        {
+            IRInstr *in = &ir[i];
+            if (!can_speculate(in))
+                continue;
+
+            int lb = operand_block(in->lhs, b->id);
+            int rb = operand_block(in->rhs, b->id);
+            int target = -1;
+            for (int l = loop_of[b->id]; l >= 0 && loops[l].preheader >= 0; l = loops[l].parent)
+            {
+                if ((lb >= 0 && in_loop(lb, l)) || (rb >= 0 && in_loop(rb, l)))
+                    break;
+                target = l;
+            }
+            if (target < 0)
+                continue;
+
+            int preheader = loops[target].preheader;
+            insert_before(preheader_end(preheader), *in);
+            def_block[in->dst.index] = preheader;
+            in->op = IR_NOP;
+            stats->hoisted++;
+        }
+    }
+}
+
+/* ---------- Strength reduction ---------- */
+
+static int32_t wrap_mul(int32_t a, int32_t b)
+{
+    return (int32_t)((uint32_t)a * (uint32_t)b);
+}
+
+// Is phi (in the header of loop l) of the form i = phi(init, i +/- c)?
+static int match_basic_iv(const IRInstr *phi, int l, BasicIV *iv)
+{
+    const Loop *loop = &loops[l];
+    BasicBlock *h = cfg_get_block(loop->header);
+    if (loop->preheader < 0 || loop->latch < 0 || phi->argc != 2)
+        return 0;
+
+    int pre = pred_slot(h, loop->preheader);
+    int back = pred_slot(h, loop->latch);
+    IROperand next = ir_phi_args(phi)[back];
+    if (next.kind != OPD_TEMP || def_instr[next.index] < 0)
+        return 0;
+
+    const IRInstr *inc = &ir[def_instr[next.index]];
+    int self_l = inc->lhs.kind == OPD_TEMP && inc->lhs.index == phi->dst.index;
+    int self_r = inc->rhs.kind == OPD_TEMP && inc->rhs.index == phi->dst.index;
+    if (inc->op == IR_ADD && self_l && inc->rhs.kind == OPD_INT)
+        iv->step = inc->rhs.imm;
+    else if (inc->op == IR_ADD && self_r && inc->lhs.kind == OPD_INT)
+        iv->step = inc->lhs.imm;
+    else if (inc->op == IR_SUB && self_l && inc->rhs.kind == OPD_INT)
+        iv->step = (int32_t)(0u - (uint32_t)inc->rhs.imm);
+    else
+        return 0;
+
+    iv->loop = l;
+    iv->init = ir_phi_args(phi)[pre];
+    iv->increment = def_instr[next.index];
+    return 1;
+}
+
+// New induction variable j = i * factor: j = phi(init * factor, j + step * factor)
+static IROperand make_derived(const BasicIV *iv, int32_t factor)
+{
+    const Loop *loop = &loops[iv->loop];
+    BasicBlock *h = cfg_get_block(loop->header);
+
+    IROperand init;
+    if (iv->init.kind == OPD_INT)
+        init = (IROperand){.kind = OPD_INT, .imm = wrap_mul(iv->init.imm, factor)};
+    else
+    {
+        init = ir_new_temp();
+        insert_before(preheader_end(loop->preheader), (IRInstr){
+            .op = IR_MUL,
+            .dst = init,
+            .lhs = iv->init,
+            .rhs = {.kind = OPD_INT, .imm = factor}});
+    }
+
+    IROperand j = ir_new_temp();
+    IROperand next = ir_new_temp();
+    IRInstr phi = ir_new_phi(SYMBOL_NONE, h->pred_count);
+    phi.dst = j;
+    ir_phi_args(&phi)[pred_slot(h, loop->preheader)] = init;
+    ir_phi_args(&phi)[pred_slot(h, loop->latch)] = next;
+    insert_before(h->first + 1, phi); // right after the header label
+
+    insert_before(iv->increment + 1, (IRInstr){
+        .op = IR_ADD,
+        .dst = next,
+        .lhs = j,
+        .rhs = {.kind = OPD_INT, .imm = wrap_mul(iv->step, factor)}});
+    return j;
+}
+
+static void reduce_strength(int ir_count, int temp_count, LoopStats *stats)
+{
+    // Basic induction variables, indexed by their phi temporary
+    BasicIV *ivs = malloc(sizeof(BasicIV) * (temp_count + 1));
+    char *is_iv = calloc(temp_count + 1, 1);
+    for (int l = 0; l < loop_count; l++)
+    {
+        BasicBlock *h = cfg_get_block(loops[l].header);
+        for (int i = h->first; i < h->end; i++)
+        {
+            if (ir[i].op == IR_PHI && match_basic_iv(&ir[i], l, &ivs[ir[i].dst.index]))
+                is_iv[ir[i].dst.index] = 1;
+        }
+    }
+
+    DerivedIV *derived = NULL;
+    int derived_count = 0, derived_capacity = 0;
+
+    for (int i = 0; i < ir_count; i++)
+    {
+        IRInstr *in = &ir[i];
+        if (in->op != IR_MUL)
+            continue;
+
+        IROperand counter = in->lhs, factor = in->rhs;
+        if (factor.kind == OPD_TEMP && counter.kind == OPD_INT)
+            counter = in->rhs, factor = in->lhs;
+        if (counter.kind != OPD_TEMP || factor.kind != OPD_INT || !is_iv[counter.index])
+            continue;
+
+        const BasicIV *iv = &ivs[counter.index];
+        if (!in_loop(def_block[in->dst.index], iv->loop))
+            continue;
+
+        IROperand value = {.kind = OPD_NONE};
+        for (int d = 0; d < derived_count; d++)
+        {
+            if (derived[d].iv == counter.index && derived[d].factor == factor.imm)
+                value = derived[d].value;
+        }
+        if (value.kind == OPD_NONE)
+        {
+            value = make_derived(iv, factor.imm);
+            if (derived_count >= derived_capacity)
+            {
+                derived_capacity = derived_capacity ? derived_capacity * 2 : 16;
+                derived = realloc(derived, sizeof(DerivedIV) * derived_capacity);
+            }
+            derived[derived_count++] = (DerivedIV){counter.index, factor.imm, value};
+        }
+
+        *in = (IRInstr){.op = IR_ASSIGN, .dst = in->dst, .lhs = value};
+        stats->reduced++;
+    }
+
+    free(ivs);
+    free(is_iv);
+    free(derived);
+}
+
+/* ---------- Rewrite ---------- */
+
+static int compare_inserts(const void *a, const void *b)
+{
+    const Insertion *x = a, *y = b;
+    if (x->before != y->before)
+        return x->before < y->before ? -1 : 1;
+    return x->seq - y->seq;
+}
+
+static void apply_inserts(int ir_count)
+{
+    if (!insert_count)
+        return;
+
+    qsort(inserts, insert_count, sizeof(Insertion), compare_inserts);
+
+    int capacity = ir_count + insert_count;
+    IRInstr *out = malloc(sizeof(IRInstr) * capacity);
+    int n = 0, k = 0;
+    for (int i = 0; i <= ir_count; i++)
+    {
+        while (k < insert_count && inserts[k].before == i)
+            out[n++] = inserts[k++].in;
+        if (i < ir_count)
+            out[n++] = ir[i];
+    }
+    ir_replace(out, n, capacity);
+    cfg_build(out, n);
+}
+
+/* ---------- Unrolling ---------- */
+
+// Copies of the body allowed for a full unroll, and per partial unroll
+#define UNROLL_FULL_BUDGET 128
+#define UNROLL_PARTIAL_BUDGET 256
+// Longest trip count worth simulating
+#define UNROLL_MAX_TRIPS (1 << 20)
+
+static IROperand *rename_map; // per temporary; OPD_NONE keeps the name
+static int *phi_at;           // header phi positions of the loop being unrolled
+
+static IROperand renamed(IROperand v)
+{
+    if (v.kind == OPD_TEMP && rename_map[v.index].kind != OPD_NONE)
+        return rename_map[v.index];
+    return v;
+}
+
+static int compare_holds(int op, int32_t a, int32_t b)
+{
+    switch (op)
+    {
+    case IR_EQ: return a == b;
+    case IR_NE: return a != b;
+    case IR_LT: return a < b;
+    case IR_GT: return a > b;
+    case IR_LE: return a <= b;
+    case IR_GE: return a >= b;
+    default: return -1;
+    }
+}
+
+static int mirror_compare(int op)
+{
+    switch (op)
+    {
+    case IR_LT: return IR_GT;
+    case IR_GT: return IR_LT;
+    case IR_LE: return IR_GE;
+    case IR_GE: return IR_LE;
+    default: return op;
+    }
+}
+
+// Iterations of `for (i = init; i op bound; i += step)`, or -1
+static long trip_count(int op, int32_t init, int32_t bound, int32_t step)
+{
+    int32_t v = init;
+    long trips = 0;
+    while (compare_holds(op, v, bound) == 1)
+    {
+        if (++trips > UNROLL_MAX_TRIPS)
+            return -1;
+        v = (int32_t)((uint32_t)v + (uint32_t)step);
+    }
+    return compare_holds(op, v, bound) < 0 ? -1 : trips;
+}
+
+// Emit one copy of the latch body in front of `before`. Header phis
+// (at ir[phi_at[p]]) read `cur` and are advanced to the values the copy
+// feeds back.
+static void copy_body(const BasicBlock *latch, const int *phi_at, int phi_count,
+                      int back, IROperand *cur, int before)
+{
+    for (int p = 0; p < phi_count; p++)
+        rename_map[ir[phi_at[p]].dst.index] = cur[p];
+
+    for (int i = latch->first; i < latch->end; i++)
+    {
+        if (ir[i].op == IR_NOP || ir[i].op == IR_GOTO)
+            continue;
+        IRInstr copy = ir[i];
+        IROperand *uses[2];
+        int n = ir_uses(&copy, uses);
+        for (int u = 0; u < n; u++)
+            *uses[u] = renamed(*uses[u]);
+        IROperand *def = ir_def(&copy);
+        if (def && def->kind == OPD_TEMP)
+        {
+            IROperand fresh = ir_new_temp();
+            rename_map[def->index] = fresh;
+            *def = fresh;
+        }
+        insert_before(before, copy);
+    }
+
+    for (int p = 0; p < phi_count; p++)
+        cur[p] = renamed(ir_phi_args(&ir[phi_at[p]])[back]);
+
+    // Names are per copy: later copies and loops must see the originals
+    for (int p = 0; p < phi_count; p++)
+        rename_map[ir[phi_at[p]].dst.index] = (IROperand){0};
+    for (int i = latch->first; i < latch->end; i++)
+    {
+        IROperand *def = ir_def(&ir[i]);
+        if (ir[i].op != IR_NOP && def && def->kind == OPD_TEMP)
+            rename_map[def->index] = (IROperand){0};
+    }
+}
+
+// A counted loop of two blocks: the header (phis, one compare, the exit
+// branch) and a straight-line latch that falls out of it
+static void unroll_loop(int l, int factor, UnrollStats *stats)
+{
+    const Loop *loop = &loops[l];
+    BasicBlock *h = cfg_get_block(loop->header);
+    if (loop->preheader < 0 || loop->latch < 0 || h->pred_count != 2 || h->succ_count != 2)
+        return;
+    BasicBlock *latch = cfg_get_block(loop->latch);
+    if (cfg_succs(h)[0] != latch->id || latch->pred_count != 1 || latch->succ_count != 1)
+        return;
+
+    // SCCP and GVN leave dead phis as NOPs, so the phis need not be
+    // contiguous
+    int phi_count = 0, cmp = -1, branch = h->end - 1;
+    for (int i = h->first; i < branch; i++)
+    {
+        if (ir[i].op == IR_PHI)
+            phi_at[phi_count++] = i;
+        else if (IR_IS_BINARY(ir[i].op) && cmp < 0)
+            cmp = i;
+        else if (ir[i].op != IR_LABEL && ir[i].op != IR_NOP)
+            return;
+    }
+    if (ir[branch].op != IR_IF_FALSE || cmp < 0 || phi_count == 0 ||
+        ir[branch].lhs.kind != OPD_TEMP || ir[branch].lhs.index != ir[cmp].dst.index)
+        return;
+
+    int size = 0;
+    for (int i = latch->first; i < latch->end; i++)
+    {
+        if (ir[i].op == IR_LABEL || ir[i].op == IR_PHI)
+            return;
+        if (ir[i].op != IR_NOP && ir[i].op != IR_GOTO)
+            size++;
+    }
+
+    // The compare must test a basic induction variable against a constant
+    const IRInstr *c = &ir[cmp];
+    int op = c->op;
+    IROperand counter = c->lhs, bound = c->rhs;
+    if (counter.kind == OPD_INT)
+    {
+        counter = c->rhs, bound = c->lhs;
+        op = mirror_compare(op);
+    }
+    if (counter.kind != OPD_TEMP || bound.kind != OPD_INT)
+        return;
+
+    int iv = -1;
+    BasicIV basic;
+    for (int p = 0; p < phi_count; p++)
+    {
+        const IRInstr *phi = &ir[phi_at[p]];
+        if (phi->dst.index == counter.index && match_basic_iv(phi, l, &basic))
+            iv = p;
+    }
+    if (iv < 0 || basic.init.kind != OPD_INT || def_block[ir[basic.increment].dst.index] != latch->id)
+        return;
+
+    long trips = trip_count(op, basic.init.imm, bound.imm, basic.step);
+    if (trips < 0)
+        return;
+
+    int pre = pred_slot(h, loop->preheader);
+    int back = pred_slot(h, loop->latch);
+    int peel_at = preheader_end(loop->preheader);
+    IROperand *cur = malloc(sizeof(IROperand) * phi_count);
+    for (int p = 0; p < phi_count; p++)
+        cur[p] = ir_phi_args(&ir[phi_at[p]])[pre];
+
+    if (trips * size <= UNROLL_FULL_BUDGET)
+    {
+        // Every iteration runs in the preheader; the header only forwards
+        // the final values and leaves, so the latch becomes unreachable
+        for (long k = 0; k < trips; k++)
+            copy_body(latch, phi_at, phi_count, back, cur, peel_at);
+        for (int p = 0; p < phi_count; p++)
+            ir[phi_at[p]] = (IRInstr){.op = IR_ASSIGN, .dst = ir[phi_at[p]].dst, .lhs = cur[p]};
+        ir[branch] = (IRInstr){.op = IR_GOTO, .dst = ir[branch].dst};
+        stats->full++;
+    }
+    else if (factor > 1 && trips >= 2 * factor && (long)size * factor <= UNROLL_PARTIAL_BUDGET)
+    {
+        // Peel trips % factor iterations in front so the loop runs a whole
+        // number of factor-sized steps and can exit on i != end
+        for (long k = 0; k < trips % factor; k++)
+            copy_body(latch, phi_at, phi_count, back, cur, peel_at);
+        for (int p = 0; p < phi_count; p++)
+        {
+            ir_phi_args(&ir[phi_at[p]])[pre] = cur[p];
+            cur[p] = ir_phi_args(&ir[phi_at[p]])[back];
+        }
+        for (int k = 1; k < factor; k++)
+            copy_body(latch, phi_at, phi_count, back, cur, latch->end - 1);
+        for (int p = 0; p < phi_count; p++)
+            ir_phi_args(&ir[phi_at[p]])[back] = cur[p];
+
+        int32_t end = (int32_t)((uint32_t)basic.init.imm + (uint32_t)trips * (uint32_t)basic.step);
+        IROperand test = ir_new_temp();
+        insert_before(branch, (IRInstr){
+            .op = IR_NE,
+            .dst = test,
+            .lhs = counter,
+            .rhs = {.kind = OPD_INT, .imm = end}});
+        ir[branch].lhs = test;
+        stats->partial++;
+    }
+    free(cur);
+}
+
+/* ---------- Passes ---------- */
+
+static void analyze(void)
+{
+    int ir_count;
+    ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+    int temp_count = ir_temp_count();
+
+    loop_of = malloc(sizeof(int) * block_count);
+    def_block = malloc(sizeof(int) * (temp_count + 1));
+    def_instr = malloc(sizeof(int) * (temp_count + 1));
+    for (int t = 0; t < temp_count; t++)
+        def_block[t] = def_instr[t] = -1;
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        for (int i = block->first; i < block->end; i++)
+        {
+            IROperand *def = ir_def(&ir[i]);
+            if (def && def->kind == OPD_TEMP)
+            {
+                def_block[def->index] = b;
+                def_instr[def->index] = i;
+            }
+        }
+    }
+
+    find_loops(block_count);
+    insert_count = 0;
+}
+
+static void finish(void)
+{
+    int ir_count;
+    ir_get_all(&ir_count);
+    apply_inserts(ir_count);
+
+    free(loops);
+    free(loop_of);
+    free(def_block);
+    free(def_instr);
+    free(inserts);
+    inserts = NULL;
+    insert_capacity = 0;
+}
+
+void opt_loops(LoopStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    analyze();
+    stats->loops = loop_count;
+    hoist_invariants(stats);
+
+    int ir_count;
+    ir_get_all(&ir_count);
+    reduce_strength(ir_count, ir_temp_count(), stats);
+    finish();
+}
+
+void opt_unroll(int factor, UnrollStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    analyze();
+
+    int temp_count = ir_temp_count();
+    int ir_count;
+    ir_get_all(&ir_count);
+    rename_map = calloc(temp_count + 1, sizeof(IROperand));
+    phi_at = malloc(sizeof(int) * (ir_count + 1));
+    for (int l = 0; l < loop_count; l++)
+        unroll_loop(l, factor, stats);
+    free(rename_map);
+    free(phi_at);
+    finish();
+}
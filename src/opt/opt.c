@@ -3,109 +3,208 @@
 #include <string.h>
 #include "opt.h"
 
-static char *strdup_safe(const char *s)
+static int is_control(IROp op)
 {
-    if (!s) return NULL;
-    size_t len = strlen(s) + 1;
-    char *copy = malloc(len);
-    if (!copy) {
-        perror("malloc");
-        exit(1);
-    }
-    memcpy(copy, s, len);
-    return copy;
+    return op == IR_LABEL || op == IR_GOTO || op == IR_IF_FALSE || op == IR_RET;
 }
 
-
-static int is_number(const char *s)
+// Only pure value-producing instructions can go; JS division does not trap
+static int is_removable(IROp op)
 {
-    for (int i = 0; s[i]; i++)
-        if (s[i] < '0' || s[i] > '9')
-            return 0;
-    return 1;
+    return op == IR_ASSIGN || op == IR_PHI || IR_IS_BINARY(op);
 }
 
-static ASTNode *fold_node(ASTNode *n)
-{
-    if (!n)
-        return NULL;
-
-    n->left = fold_node(n->left);
-    n->right = fold_node(n->right);
-
-    if (n->type == AST_BINARY_OP &&
-        n->left && n->right &&
-        n->left->type == AST_LITERAL &&
-        n->right->type == AST_LITERAL &&
-        is_number(n->left->value) &&
-        is_number(n->right->value))
-    {
+// Temporaries take slots [0, temps), variables [temps, temps + vars)
+static int temp_count;
 
-        int a = atoi(n->left->value);
-        int b = atoi(n->right->value);
-        int res = 0;
-
-        if (!strcmp(n->value, "+"))
-            res = a + b;
-        else if (!strcmp(n->value, "-"))
-            res = a - b;
-        else if (!strcmp(n->value, "*"))
-            res = a * b;
-        else if (!strcmp(n->value, "/"))
-            res = b ? a / b : 0;
-        else
-            return n;
-
-        // 🔥 mutate node in-place
-        free(n->value);
-        n->value = strdup_safe((char[32]){0});
-        sprintf(n->value, "%d", res);
-
-        n->type = AST_LITERAL;
-        n->left = NULL;
-        n->right = NULL;
-
-        return n;
-    }
+static int slot_of(IROperand v)
+{
+    if (v.kind == OPD_TEMP)
+        return (int)v.index;
+    if (v.kind == OPD_VAR)
+        return temp_count + (int)v.index;
+    return -1;
+}
 
-    return n;
+static int var_name(IROperand v)
+{
+    return v.kind == OPD_VAR ? (int)v.index : -1;
 }
 
-void opt_constant_folding(void)
+static int *def_first; // per slot: its definitions in def_list
+static int *def_list;
+static uint8_t *live;  // per instruction
+static uint8_t *dead_store;
+static int *worklist;
+static int work_count;
+
+static void mark(int i)
 {
-    // For now, folding happens before IR, so this is a hook
-    // Call fold_node(program_ast) in main
+    if (!live[i] && !dead_store[i])
+    {
+        live[i] = 1;
+        worklist[work_count++] = i;
+    }
 }
 
-static void dfs(BasicBlock *b, int *visited)
+static void mark_defs(IROperand v)
 {
-    if (!b || visited[b->id])
+    int slot = slot_of(v);
+    if (slot < 0)
         return;
-    visited[b->id] = 1;
-
-    for (int i = 0; i < b->succ_count; i++)
-        dfs(b->succ[i], visited);
+    for (int k = def_first[slot]; k < def_first[slot + 1]; k++)
+        mark(def_list[k]);
 }
 
-void opt_dead_code_elimination(void)
+void opt_dead_code_elimination(DceStats *stats)
 {
-    int count = cfg_block_count();
-    int visited[128] = {0};
+    int ir_count;
+    IRInstr *ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+    memset(stats, 0, sizeof(*stats));
 
-    dfs(cfg_get_block(0), visited);
+    // Control instructions stay so the CFG keeps its shape
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        if (block->rpo >= 0)
+            continue;
 
-    for (int i = 0; i < count; i++)
+        int removed = 0;
+        for (int i = block->first; i < block->end; i++)
+        {
+            if (ir[i].op != IR_NOP && !is_control(ir[i].op))
+            {
+                ir[i].op = IR_NOP;
+                removed = 1;
+            }
+        }
+        stats->unreachable_blocks += removed;
+    }
+
+    // Definitions per slot
+    temp_count = ir_temp_count() + 1;
+    int slots = temp_count + semantic_symbol_count() + 1;
+    def_first = calloc(slots + 1, sizeof(int));
+    for (int i = 0; i < ir_count; i++)
+    {
+        IROperand *def = ir[i].op == IR_NOP ? NULL : ir_def(&ir[i]);
+        int slot = def ? slot_of(*def) : -1;
+        if (slot >= 0)
+            def_first[slot + 1]++;
+    }
+    for (int s = 0; s < slots; s++)
+        def_first[s + 1] += def_first[s];
+    def_list = malloc(sizeof(int) * (def_first[slots] + 1));
+    int *fill = malloc(sizeof(int) * slots);
+    memcpy(fill, def_first, sizeof(int) * slots);
+    for (int i = 0; i < ir_count; i++)
+    {
+        IROperand *def = ir[i].op == IR_NOP ? NULL : ir_def(&ir[i]);
+        int slot = def ? slot_of(*def) : -1;
+        if (slot >= 0)
+            def_list[fill[slot]++] = i;
+    }
+    free(fill);
+
+    // A variable store is never seen, whoever reads the variable, if it is
+    // overwritten later in its block before any read, or if nothing reads
+    // it later in its block and the variable is not live out of it
+    int vars = semantic_symbol_count() + 1;
+    Liveness var_live;
+    liveness_build(&var_live, vars, var_name);
+    int *live_in_first = calloc(block_count + 1, sizeof(int));
+    int *live_in = malloc(sizeof(int) * (var_live.first[vars] + 1));
+    for (int k = 0; k < var_live.first[vars]; k++)
+        live_in_first[var_live.blocks[k] + 1]++;
+    for (int b = 0; b < block_count; b++)
+        live_in_first[b + 1] += live_in_first[b];
+    fill = malloc(sizeof(int) * (block_count + 1));
+    memcpy(fill, live_in_first, sizeof(int) * (block_count + 1));
+    for (int v = 0; v < vars; v++)
+        for (int k = var_live.first[v]; k < var_live.first[v + 1]; k++)
+            live_in[fill[var_live.blocks[k]]++] = v;
+    free(fill);
+    liveness_free(&var_live);
+
+    live = calloc(ir_count + 1, 1);
+    dead_store = calloc(ir_count + 1, 1);
+    // Per variable, stamped with b + 1 while block b is swept
+    int *live_out = calloc(vars, sizeof(int));
+    int *accessed = calloc(vars, sizeof(int));
+    int *stored = calloc(vars, sizeof(int));
+    for (int b = 0; b < block_count; b++)
     {
-        if (!visited[i])
+        BasicBlock *block = cfg_get_block(b);
+        if (block->rpo < 0)
+            continue;
+        const int *succs = cfg_succs(block);
+        for (int s = 0; s < block->succ_count; s++)
+            for (int k = live_in_first[succs[s]]; k < live_in_first[succs[s] + 1]; k++)
+                live_out[live_in[k]] = b + 1;
+
+        for (int i = block->end - 1; i >= block->first; i--)
         {
-            BasicBlock *b = cfg_get_block(i);
-            printf("DCE: removing unreachable block B%d\n", b->id);
-            b->stmt_count = 0;
+            if (ir[i].op == IR_NOP)
+                continue;
+            IROperand *def = ir_def(&ir[i]);
+            if (def && def->kind == OPD_VAR && is_removable(ir[i].op))
+            {
+                int v = def->index;
+                dead_store[i] = accessed[v] == b + 1 ? stored[v] == b + 1 : live_out[v] != b + 1;
+                accessed[v] = stored[v] = b + 1;
+            }
+            IROperand *uses[2];
+            int n = ir_uses(&ir[i], uses);
+            for (int u = 0; u < n; u++)
+            {
+                if (uses[u]->kind == OPD_VAR)
+                {
+                    accessed[uses[u]->index] = b + 1;
+                    stored[uses[u]->index] = 0;
+                }
+            }
         }
     }
-}
+    free(stored);
+    free(accessed);
+    free(live_out);
+    free(live_in);
+    free(live_in_first);
+
+    // Mark from the instructions with effects; dead cycles of phis stay
+    // unmarked, which counting uses alone would miss
+    worklist = malloc(sizeof(int) * (ir_count + 1));
+    work_count = 0;
+    for (int i = 0; i < ir_count; i++)
+        if (ir[i].op != IR_NOP && !is_removable(ir[i].op))
+            mark(i);
+    while (work_count > 0)
+    {
+        IRInstr *in = &ir[worklist[--work_count]];
+        IROperand *uses[2];
+        int n = ir_uses(in, uses);
+        for (int u = 0; u < n; u++)
+            mark_defs(*uses[u]);
+        if (in->op == IR_PHI)
+            for (int k = 0; k < in->argc; k++)
+                mark_defs(ir_phi_args(in)[k]);
+    }
 
-ASTNode *opt_fold_constants(ASTNode *root)
-{
-    return fold_node(root);
+    for (int i = 0; i < ir_count; i++)
+    {
+        if (ir[i].op == IR_NOP || live[i] || !is_removable(ir[i].op))
+            continue;
+        if (ir_def(&ir[i])->kind == OPD_VAR)
+            stats->dead_stores++;
+        else
+            stats->dead_instrs++;
+        ir[i].op = IR_NOP;
+    }
+
+    free(worklist);
+    free(live);
+    free(dead_store);
+    free(def_list);
+    free(def_first);
 }
@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "opt.h"
+
+// Sparse conditional constant propagation (Wegman and Zadeck) over the
+// SSA form. Values are 32-bit words, like the QBE backend's.
+
+typedef enum {
+    LAT_TOP,   // no executable definition seen yet
+    LAT_CONST,
+    LAT_BOTTOM // varies at run time
+} LatticeState;
+
+typedef struct {
+    uint8_t state;
+    int32_t value;
+} Lattice;
+
+static IRInstr *ir;
+static Lattice *values;  // per temporary
+static int *block_of;    // per instruction
+static char *exec_block;
+static char *exec_edge;  // per CFG edge (succ_first + k)
+
+// Def-use chains: instructions reading temp t are use_instrs[use_first[t] ..]
+static int *use_first;
+static int *use_instrs;
+
+static int *ssa_work;
+static int ssa_top = 0;
+static int *edge_work; // (block, successor index) pairs
+static int edge_top = 0;
+
+/* ---------- Lattice ---------- */
+
+static Lattice operand_value(IROperand v)
+{
+    switch (v.kind)
+    {
+    case OPD_TEMP:
+        return values[v.index];
+    case OPD_INT:
+        return (Lattice){LAT_CONST, v.imm};
+    case OPD_NONE:
+        return (Lattice){LAT_TOP, 0};
+    default: // strings, wide and fractional constants, memory
+        return (Lattice){LAT_BOTTOM, 0};
+    }
+}
+
+static Lattice meet(Lattice a, Lattice b)
+{
+    if (a.state == LAT_TOP)
+        return b;
+    if (b.state == LAT_TOP)
+        return a;
+    if (a.state == LAT_BOTTOM || b.state == LAT_BOTTOM || a.value != b.value)
+        return (Lattice){LAT_BOTTOM, 0};
+    return a;
+}
+
+static void set_value(IROperand dst, Lattice v)
+{
+    if (dst.kind != OPD_TEMP)
+        return;
+    Lattice *old = &values[dst.index];
+    if (old->state == v.state && (v.state != LAT_CONST || old->value == v.value))
+        return;
+    *old = v;
+    ssa_work[ssa_top++] = dst.index;
+}
+
+// Same results as the generated code: wrapping word arithmetic, signed
+// compares; division by zero and overflow are left to run time
+static Lattice fold(IROp op, int32_t a, int32_t b)
+{
+    uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+    int32_t r;
+    switch (op)
+    {
+    case IR_ADD: r = (int32_t)(ua + ub); break;
+    case IR_SUB: r = (int32_t)(ua - ub); break;
+    case IR_MUL: r = (int32_t)(ua * ub); break;
+    case IR_DIV:
+        if (b == 0 || (a == INT32_MIN && b == -1))
+            return (Lattice){LAT_BOTTOM, 0};
+        r = a / b;
+        break;
+    case IR_EQ: r = a == b; break;
+    case IR_NE: r = a != b; break;
+    case IR_LT: r = a < b; break;
+    case IR_GT: r = a > b; break;
+    case IR_LE: r = a <= b; break;
+    case IR_GE: r = a >= b; break;
+    default:
+        return (Lattice){LAT_BOTTOM, 0};
+    }
+    return (Lattice){LAT_CONST, r};
+}
+
+/* ---------- Propagation ---------- */
+
+static int edge_to(const BasicBlock *from, int to)
+{
+    const int *succs = cfg_succs(from);
+    for (int k = 0; k < from->succ_count; k++)
+        if (succs[k] == to)
+            return from->succ_first + k;
+    return -1;
+}
+
+static void mark_edge(const BasicBlock *from, int k)
+{
+    int edge = from->succ_first + k;
+    if (exec_edge[edge])
+        return;
+    exec_edge[edge] = 1;
+    edge_work[edge_top++] = from->id;
+    edge_work[edge_top++] = k;
+}
+
+static void visit_branch(const IRInstr *in, const BasicBlock *b)
+{
+    Lattice cond = operand_value(in->lhs);
+    if (cond.state == LAT_TOP)
+        return;
+    if (cond.state == LAT_BOTTOM || b->succ_count == 1)
+    {
+        for (int k = 0; k < b->succ_count; k++)
+            mark_edge(b, k);
+        return;
+    }
+    // succs are {fallthrough, jump target}; the jump is taken on zero
+    mark_edge(b, cond.value ? 0 : 1);
+}
+
+static void visit(int i)
+{
+    IRInstr *in = &ir[i];
+    const BasicBlock *b = cfg_get_block(block_of[i]);
+
+    switch (in->op)
+    {
+    case IR_PHI:
+    {
+        const int *preds = cfg_preds(b);
+        Lattice v = {LAT_TOP, 0};
+        for (int j = 0; j < in->argc; j++)
+        {
+            if (exec_edge[edge_to(cfg_get_block(preds[j]), b->id)])
+                v = meet(v, operand_value(ir_phi_args(in)[j]));
+        }
+        set_value(in->dst, v);
+        break;
+    }
+
+    case IR_ASSIGN:
+        set_value(in->dst, operand_value(in->lhs));
+        break;
+
+    case IR_IF_FALSE:
+        visit_branch(in, b);
+        break;
+
+    default:
+        if (IR_IS_BINARY(in->op))
+        {
+            Lattice l = operand_value(in->lhs);
+            Lattice r = operand_value(in->rhs);
+            if (l.state == LAT_TOP || r.state == LAT_TOP)
+                break;
+            if (l.state == LAT_BOTTOM || r.state == LAT_BOTTOM)
+                set_value(in->dst, (Lattice){LAT_BOTTOM, 0});
+            else
+                set_value(in->dst, fold(in->op, l.value, r.value));
+        }
+        break;
+    }
+}
+
+static void visit_block(const BasicBlock *b)
+{
+    for (int i = b->first; i < b->end; i++)
+        visit(i);
+
+    // Anything but a conditional jump leaves along every edge
+    if (b->end == b->first || ir[b->end - 1].op != IR_IF_FALSE)
+    {
+        for (int k = 0; k < b->succ_count; k++)
+            mark_edge(b, k);
+    }
+}
+
+static void build_use_chains(int ir_count, int temp_count)
+{
+    use_first = calloc(temp_count + 1, sizeof(int));
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int *fill = pass ? calloc(temp_count, sizeof(int)) : NULL;
+        for (int i = 0; i < ir_count; i++)
+        {
+            IROperand *uses[2];
+            int n = ir_uses(&ir[i], uses);
+            IROperand *args = ir[i].op == IR_PHI ? ir_phi_args(&ir[i]) : NULL;
+            int argc = args ? ir[i].argc : 0;
+
+            for (int u = 0; u < n + argc; u++)
+            {
+                IROperand *v = u < n ? uses[u] : &args[u - n];
+                if (v->kind != OPD_TEMP)
+                    continue;
+                if (pass)
+                    use_instrs[use_first[v->index] + fill[v->index]++] = i;
+                else
+                    use_first[v->index + 1]++;
+            }
+        }
+        if (!pass)
+        {
+            for (int t = 0; t < temp_count; t++)
+                use_first[t + 1] += use_first[t];
+            use_instrs = malloc(sizeof(int) * (use_first[temp_count] + 1));
+        }
+        free(fill);
+    }
+}
+
+static void propagate(void)
+{
+    exec_block[0] = 1;
+    visit_block(cfg_get_block(0));
+
+    while (edge_top || ssa_top)
+    {
+        while (edge_top)
+        {
+            int k = edge_work[--edge_top];
+            const BasicBlock *from = cfg_get_block(edge_work[--edge_top]);
+            const BasicBlock *to = cfg_get_block(cfg_succs(from)[k]);
+
+            if (!exec_block[to->id])
+            {
+                exec_block[to->id] = 1;
+                visit_block(to);
+                continue;
+            }
+            for (int i = to->first; i < to->end; i++)
+            {
+                if (ir[i].op == IR_PHI)
+                    visit(i);
+                else if (ir[i].op != IR_LABEL)
+                    break;
+            }
+        }
+
+        while (ssa_top)
+        {
+            int t = ssa_work[--ssa_top];
+            for (int u = use_first[t]; u < use_first[t + 1]; u++)
+            {
+                int i = use_instrs[u];
+                if (exec_block[block_of[i]])
+                    visit(i);
+            }
+        }
+    }
+}
+
+/* ---------- Rewrite ---------- */
+
+static void substitute(IROperand *v)
+{
+    if (v->kind == OPD_TEMP && values[v->index].state == LAT_CONST)
+        *v = (IROperand){.kind = OPD_INT, .imm = values[v->index].value};
+}
+
+// Constant uses become immediates and their definitions go away. Branches
+// on a constant now have a single CFG edge, so phis lose the arguments of
+// the edges that disappeared.
+static void rewrite(int ir_count, int block_count)
+{
+    for (int i = 0; i < ir_count; i++)
+    {
+        IRInstr *in = &ir[i];
+        IROperand *uses[2];
+        int n = ir_uses(in, uses);
+        for (int u = 0; u < n; u++)
+            substitute(uses[u]);
+        if (in->op == IR_PHI)
+            for (int j = 0; j < in->argc; j++)
+                substitute(&ir_phi_args(in)[j]);
+
+        IROperand *def = ir_def(in);
+        if (def && def->kind == OPD_TEMP && values[def->index].state == LAT_CONST)
+            in->op = IR_NOP;
+    }
+
+    // Old predecessor lists, to remap phi arguments after the rebuild
+    int edge_count = 0;
+    for (int b = 0; b < block_count; b++)
+        edge_count += cfg_get_block(b)->pred_count;
+    int *old_first = malloc(sizeof(int) * (block_count + 1));
+    int *old_preds = malloc(sizeof(int) * (edge_count + 1));
+    old_first[0] = 0;
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        memcpy(&old_preds[old_first[b]], cfg_preds(block), sizeof(int) * block->pred_count);
+        old_first[b + 1] = old_first[b] + block->pred_count;
+    }
+
+    cfg_build(ir, ir_count);
+
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        int old_count = old_first[b + 1] - old_first[b];
+        if (block->pred_count == old_count)
+            continue;
+
+        const int *preds = cfg_preds(block);
+        for (int i = block->first; i < block->end; i++)
+        {
+            if (ir[i].op == IR_LABEL || ir[i].op == IR_NOP)
+                continue;
+            if (ir[i].op != IR_PHI)
+                break;
+
+            IRInstr phi = ir_new_phi(ir[i].rhs.index, block->pred_count);
+            phi.dst = ir[i].dst;
+            for (int k = 0; k < block->pred_count; k++)
+            {
+                for (int j = 0; j < old_count; j++)
+                    if (old_preds[old_first[b] + j] == preds[k])
+                        ir_phi_args(&phi)[k] = ir_phi_args(&ir[i])[j];
+            }
+            ir[i] = phi;
+        }
+    }
+
+    free(old_first);
+    free(old_preds);
+}
+
+void opt_sccp(void)
+{
+    int ir_count;
+    ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+    int temp_count = ir_temp_count();
+
+    values = calloc(temp_count + 1, sizeof(Lattice));
+    block_of = malloc(sizeof(int) * (ir_count + 1));
+    exec_block = calloc(block_count, 1);
+    exec_edge = calloc(block_count * 2, 1);
+    ssa_work = malloc(sizeof(int) * (temp_count * 3 + 1));
+    edge_work = malloc(sizeof(int) * (block_count * 4 + 1));
+
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        for (int i = block->first; i < block->end; i++)
+            block_of[i] = b;
+    }
+
+    build_use_chains(ir_count, temp_count);
+    propagate();
+    rewrite(ir_count, block_count);
+
+    free(values);
+    free(block_of);
+    free(exec_block);
+    free(exec_edge);
+    free(ssa_work);
+    free(edge_work);
+    free(use_first);
+    free(use_instrs);
+}
@@ -15,111 +15,146 @@ typedef enum {
     PREC_PRIMARY
 } Precedence;
 
-ASTNode *parse_expression(Token tokens[], int *index);
+#define MAX_UPDATE_TEXT 256
+
+NodeId parse_expression(TokenStream *ts);
+
+/* ---------- Node allocation ---------- */
+
+// Every node goes into the compilation's flat AST
+static Ast *ast;
+
+// Statements of the blocks still being parsed, innermost last. A finished
+// block appends its slice to the AST's kids array and pops it.
+static NodeId *pending;
+static int pending_count;
+static int pending_capacity;
+
+void parser_init(Ast *tree)
+{
+    ast = tree;
+}
+
+static void push_pending(NodeId stmt)
+{
+    if (pending_count >= pending_capacity)
+    {
+        pending_capacity = pending_capacity ? pending_capacity * 2 : 64;
+        pending = realloc(pending, sizeof(NodeId) * pending_capacity);
+    }
+    pending[pending_count++] = stmt;
+}
+
+static NodeId create_node(ASTNodeType type, Atom value, NodeId left, NodeId right)
+{
+    return ast_new(ast, type, value, left, right);
+}
+
+// Turn the pending statements above base into a block node
+static NodeId finish_block(int base)
+{
+    NodeId block = create_node(AST_BLOCK, ATOM_NONE, NODE_NONE, NODE_NONE);
+    ast_set_kids(ast, block, pending + base, pending_count - base);
+    pending_count = base;
+    return block;
+}
+
+// Parse statements up to and including the closing '}'
+static NodeId parse_block(TokenStream *ts)
+{
+    int base = pending_count;
+    while (!(peek_token(ts, 0).type == TOKEN_PARENTHESES && peek_token(ts, 0).atom == ATOM_RBRACE))
+    {
+        if (peek_token(ts, 0).type == TOKEN_EOF)
+        {
+            printf("Error: Unexpected end of file. Missing closing '}'.\n");
+            exit(1);
+        }
+        NodeId stmt = parse_statement(ts);
+        if (stmt)
+            push_pending(stmt);
+    }
+    advance_token(ts); // Skip "}"
+    return finish_block(base);
+}
 
 static Precedence get_precedence(Token *token) {
     if (token->type != TOKEN_OPERATOR) return PREC_NONE;
 
-    if (strcmp(token->lexeme, "===") == 0 ||
-        strcmp(token->lexeme, "!==") == 0)
+    switch (token->atom) {
+    case ATOM_EQ_STRICT:
+    case ATOM_NE_STRICT:
         return PREC_EQUALITY;
 
-    if (strcmp(token->lexeme, "<") == 0 ||
-        strcmp(token->lexeme, ">") == 0 ||
-        strcmp(token->lexeme, "<=") == 0 ||
-        strcmp(token->lexeme, ">=") == 0)
+    case ATOM_LT:
+    case ATOM_GT:
+    case ATOM_LE:
+    case ATOM_GE:
         return PREC_COMPARISON;
 
-    if (strcmp(token->lexeme, "+") == 0 ||
-        strcmp(token->lexeme, "-") == 0)
+    case ATOM_PLUS:
+    case ATOM_MINUS:
         return PREC_TERM;
 
-    if (strcmp(token->lexeme, "*") == 0 ||
-        strcmp(token->lexeme, "/") == 0)
+    case ATOM_STAR:
+    case ATOM_SLASH:
         return PREC_FACTOR;
 
-    return PREC_NONE;
+    default:
+        return PREC_NONE;
+    }
 }
 
-static ASTNode *parse_primary(Token tokens[], int *index) {
-    Token t = tokens[*index];
+static NodeId parse_primary(TokenStream *ts) {
+    Token t = peek_token(ts, 0);
 
     if (t.type == TOKEN_NUMBER || t.type == TOKEN_STRING ||
         t.type == TOKEN_BOOLEAN) {
-        (*index)++;
-        return create_node(AST_LITERAL, t.lexeme);
+        advance_token(ts);
+        return create_node(AST_LITERAL, t.atom, NODE_NONE, NODE_NONE);
     }
 
     if (t.type == TOKEN_IDENTIFIER) {
-        (*index)++;
-        return create_node(AST_IDENTIFIER, t.lexeme);
+        advance_token(ts);
+        return create_node(AST_IDENTIFIER, t.atom, NODE_NONE, NODE_NONE);
     }
 
-    if (strcmp(t.lexeme, "(") == 0) {
-        (*index)++;
-        ASTNode *expr = parse_expression(tokens, index);
-        if (strcmp(tokens[*index].lexeme, ")") != 0) {
+    if (t.atom == ATOM_LPAREN) {
+        advance_token(ts);
+        NodeId expr = parse_expression(ts);
+        if (peek_token(ts, 0).atom != ATOM_RPAREN) {
             printf("Expected ')'\n");
             exit(1);
         }
-        (*index)++;
+        advance_token(ts);
         return expr;
     }
 
-    printf("Unexpected token: %s\n", t.lexeme);
+    printf("Unexpected token: %s\n", atom_str(t.atom));
     exit(1);
 }
 
-ASTNode *parse_expression_prec(Token tokens[], int *index, Precedence prec) {
-    ASTNode *left = parse_primary(tokens, index);
+NodeId parse_expression_prec(TokenStream *ts, Precedence prec) {
+    NodeId left = parse_primary(ts);
 
     while (1) {
-        Precedence next_prec = get_precedence(&tokens[*index]);
+        Token next = peek_token(ts, 0);
+        Precedence next_prec = get_precedence(&next);
         if (next_prec < prec)
             break;
 
-        Token op = tokens[*index];
-        (*index)++;
+        Token op = next;
+        advance_token(ts);
 
-        ASTNode *right = parse_expression_prec(tokens, index, next_prec + 1);
+        NodeId right = parse_expression_prec(ts, next_prec + 1);
 
-        ASTNode *bin = create_node(AST_BINARY_OP, op.lexeme);
-        bin->left = left;
-        bin->right = right;
-        left = bin;
+        left = create_node(AST_BINARY_OP, op.atom, left, right);
     }
 
     return left;
 }
 
 
-static char *strdup_safe(const char *s)
-{
-    if (!s) return NULL;
-    size_t len = strlen(s) + 1;
-    char *copy = malloc(len);
-    if (!copy) {
-        perror("malloc");
-        exit(1);
-    }
-    memcpy(copy, s, len);
-    return copy;
-}
-
-
-ASTNode *parse_statement(Token tokens[], int *index);
-
-ASTNode *create_node(ASTNodeType type, char *value)
-{
-    ASTNode *node = malloc(sizeof(ASTNode));
-    node->type = type;
-    node->value = value ? strdup_safe(value) : NULL;
-    node->left = node->right = NULL;
-    node->body = NULL;
-    node->body_size = 0;
-    return node;
-}
-
 char *check_binary_expr(char *leftType, char *rightType, char op)
 {
     if (strcmp(leftType, "number") == 0 && strcmp(rightType, "number") == 0)
@@ -134,211 +169,164 @@ char *check_binary_expr(char *leftType, char *rightType, char op)
     exit(1);
 }
 
-ASTNode *parse_expression(Token tokens[], int *index) {
-    return parse_expression_prec(tokens, index, PREC_ASSIGNMENT);
+NodeId parse_expression(TokenStream *ts) {
+    return parse_expression_prec(ts, PREC_ASSIGNMENT);
 }
 
-ASTNode *parse_assignment(Token tokens[], int *index)
+NodeId parse_assignment(TokenStream *ts)
 {
-    ASTNode *identifier = create_node(AST_IDENTIFIER, tokens[*index].lexeme);
-    (*index)++;
-    (*index)++; // Skip "="
-    ASTNode *assignNode = create_node(AST_ASSIGNMENT, "=");
-    assignNode->left = identifier;
-    assignNode->right = parse_expression(tokens, index);
-    (*index)++; // Skip ";"
+    NodeId identifier = create_node(AST_IDENTIFIER, peek_token(ts, 0).atom, NODE_NONE, NODE_NONE);
+    advance_token(ts);
+    advance_token(ts); // Skip "="
+    NodeId value = parse_expression(ts);
+    NodeId assignNode = create_node(AST_ASSIGNMENT, ATOM_ASSIGN, identifier, value);
+    advance_token(ts); // Skip ";"
     return assignNode;
 }
 
-ASTNode *parse_declaration(Token tokens[], int *index)
+NodeId parse_declaration(TokenStream *ts)
 {
-    // Token keyword = tokens[*index];
-    (*index)++;
-    Token identifier = tokens[*index];
-    (*index)++;
-    (*index)++; // Skip "="
-    // Token value = tokens[*index];
-
-    ASTNode *varNode = create_node(AST_VAR_DECL, identifier.lexeme);
-    ASTNode *assignNode = create_node(AST_ASSIGNMENT, "=");
-    assignNode->left = varNode;
-    assignNode->right = parse_expression(tokens, index);
+    // Token keyword = peek_token(ts, 0);
+    advance_token(ts);
+    Token identifier = peek_token(ts, 0);
+    advance_token(ts);
+    advance_token(ts); // Skip "="
+    // Token value = peek_token(ts, 0);
+
+    NodeId varNode = create_node(AST_VAR_DECL, identifier.atom, NODE_NONE, NODE_NONE);
+    NodeId value = parse_expression(ts);
+    NodeId assignNode = create_node(AST_ASSIGNMENT, ATOM_ASSIGN, varNode, value);
     
     
-    (*index)++; // Skip ";"
+    advance_token(ts); // Skip ";"
     return assignNode;
 }
 
-ASTNode *parse_print_stmt(Token tokens[], int *index)
+NodeId parse_print_stmt(TokenStream *ts)
 {
-    (*index)++; // Skip "console"
-    (*index)++; // Skip "."
-    (*index)++; // Skip "log"
-    (*index)++; // Skip "("
-    ASTNode *expr = parse_expression(tokens, index);
-    (*index)++; // Skip ")"
-    (*index)++; // Skip ";"
+    advance_token(ts); // Skip "console"
+    advance_token(ts); // Skip "."
+    advance_token(ts); // Skip "log"
+    advance_token(ts); // Skip "("
+    NodeId expr = parse_expression(ts);
+    advance_token(ts); // Skip ")"
+    advance_token(ts); // Skip ";"
     
-    ASTNode *funcCall = create_node(AST_FUNC_CALL, "console.log");
-    funcCall->body = malloc(sizeof(ASTNode*));
-    funcCall->body[0] = expr;
-    funcCall->body_size = 1;
+    NodeId funcCall = create_node(AST_FUNC_CALL, ATOM_CONSOLE_LOG, NODE_NONE, NODE_NONE);
+    ast_set_kids(ast, funcCall, &expr, 1);
     return funcCall;
 }
 
-ASTNode *parser_conditional_statement(Token tokens[], int *index)
+NodeId parser_conditional_statement(TokenStream *ts)
 {
-    Token conditionKey = tokens[*index];
-    (*index)++; // Skip "if" or "else"
-    ASTNode *condition = NULL;
+    Token conditionKey = peek_token(ts, 0);
+    advance_token(ts); // Skip "if" or "else"
+    NodeId condition = NODE_NONE;
 
-    if (strcmp(conditionKey.lexeme, "if") == 0)
+    if (conditionKey.kw == KW_IF)
     {
-        if (tokens[*index].type != TOKEN_PUNCTUATION || strcmp(tokens[*index].lexeme, "(") != 0)
+        if (peek_token(ts, 0).type != TOKEN_PUNCTUATION || peek_token(ts, 0).atom != ATOM_LPAREN)
         {
             printf("Error: Expected '(' after 'if'\n");
             exit(1);
         }
 
-        (*index)++; // Skip "("
-        condition = parse_expression(tokens, index);
+        advance_token(ts); // Skip "("
+        condition = parse_expression(ts);
 
-        if (tokens[*index].type != TOKEN_PUNCTUATION || strcmp(tokens[*index].lexeme, ")") != 0)
+        if (peek_token(ts, 0).type != TOKEN_PUNCTUATION || peek_token(ts, 0).atom != ATOM_RPAREN)
         {
             printf("Error: Expected ')' after condition\n");
             exit(1);
         }
-        (*index)++; // Skip ")"
+        advance_token(ts); // Skip ")"
     }
 
-    if (tokens[*index].type != TOKEN_PARENTHESES || strcmp(tokens[*index].lexeme, "{") != 0)
+    if (peek_token(ts, 0).type != TOKEN_PARENTHESES || peek_token(ts, 0).atom != ATOM_LBRACE)
     {
         printf("Error: Expected '{' after condition\n");
         exit(1);
     }
-    (*index)++; // Skip "{"
+    advance_token(ts); // Skip "{"
     
-    ASTNode *block = create_node(AST_BLOCK, NULL);
-    block->body = malloc(sizeof(ASTNode *) * 10);
-    block->body_size = 0;
-    int capacity = 10;
+    NodeId block = parse_block(ts);
 
-    while (!(tokens[*index].type == TOKEN_PARENTHESES && strcmp(tokens[*index].lexeme, "}") == 0))
-    {
-        if (tokens[*index].type == TOKEN_EOF)
-        {
-            printf("Error: Unexpected end of file. Missing closing '}'.\n");
-            exit(1);
-        }
-
-        if (block->body_size >= capacity)
-        {
-            capacity *= 2;
-            block->body = realloc(block->body, sizeof(ASTNode *) * capacity);
-        }
-
-        block->body[block->body_size++] = parse_statement(tokens, index);
-    }
-    (*index)++; // Skip "}"
-
-    ASTNode *conditionNode = create_node(
-        strcmp(conditionKey.lexeme, "if") == 0 ? AST_IF_STMT : AST_ELSE_STMT,
-        conditionKey.lexeme
+    return create_node(
+        conditionKey.kw == KW_IF ? AST_IF_STMT : AST_ELSE_STMT,
+        intern_cstr(keyword_text(conditionKey.kw)),
+        condition,
+        block
     );
-    
-    if (strcmp(conditionKey.lexeme, "if") == 0)
-    {
-        conditionNode->left = condition;
-    }
-    conditionNode->right = block;
-    return conditionNode;
 }
 
-ASTNode *parse_update(Token tokens[], int *index)
+// Update nodes keep their full text ("i++") as the value and the
+// updated variable as the left child
+static NodeId create_update_node(ASTNodeType type, Token *parts, Atom var)
 {
-    if (strcmp(tokens[*index].lexeme, "+") == 0 || strcmp(tokens[*index].lexeme, "-") == 0)
-    {
-        // Pre-increment: ++i or --i
-        ASTNode *updateNode = create_node(AST_PRE_UPDATE, NULL);
-        size_t len =
-    strlen(tokens[*index].lexeme) +
-    strlen(tokens[*index + 1].lexeme) +
-    strlen(tokens[*index + 2].lexeme) + 1;
-
-char *buffer = malloc(len);
-if (!buffer) {
-    fprintf(stderr, "Out of memory\n");
-    exit(1);
+    char text[MAX_UPDATE_TEXT];
+    snprintf(text, sizeof(text), "%s%s%s",
+             atom_str(parts[0].atom), atom_str(parts[1].atom), atom_str(parts[2].atom));
+    NodeId target = create_node(AST_IDENTIFIER, var, NODE_NONE, NODE_NONE);
+    return create_node(type, intern_cstr(text), target, NODE_NONE);
 }
 
-snprintf(buffer, len, "%s%s%s",
-         tokens[*index].lexeme,
-         tokens[*index + 1].lexeme,
-         tokens[*index + 2].lexeme);
-
-updateNode->value = buffer;
+NodeId parse_update(TokenStream *ts)
+{
+    if (peek_token(ts, 0).atom == ATOM_PLUS || peek_token(ts, 0).atom == ATOM_MINUS)
+    {
+        // Pre-increment: ++i or --i
+        Token parts[3] = {peek_token(ts, 0), peek_token(ts, 1), peek_token(ts, 2)};
+        NodeId updateNode = create_update_node(AST_PRE_UPDATE, parts, parts[2].atom);
 
-        (*index) += 3;
+        advance_token(ts);
+        advance_token(ts);
+        advance_token(ts);
         return updateNode;
     }
-    else if (tokens[*index].type == TOKEN_IDENTIFIER)
+    else if (peek_token(ts, 0).type == TOKEN_IDENTIFIER)
     {
         // Post-increment: i++ or i--
-        ASTNode *updateNode = create_node(AST_POST_UPDATE, NULL);
-        size_t len =
-    strlen(tokens[*index].lexeme) +
-    strlen(tokens[*index + 1].lexeme) +
-    strlen(tokens[*index + 2].lexeme) + 1;
-
-char *buffer = malloc(len);
-if (!buffer) {
-    fprintf(stderr, "Out of memory\n");
-    exit(1);
-}
+        Token parts[3] = {peek_token(ts, 0), peek_token(ts, 1), peek_token(ts, 2)};
+        NodeId updateNode = create_update_node(AST_POST_UPDATE, parts, parts[0].atom);
 
-snprintf(buffer, len, "%s%s%s",
-         tokens[*index].lexeme,
-         tokens[*index + 1].lexeme,
-         tokens[*index + 2].lexeme);
-
-updateNode->value = buffer;
-
-        (*index) += 3;
+        advance_token(ts);
+        advance_token(ts);
+        advance_token(ts);
         return updateNode;
     }
-    return NULL;
+    return NODE_NONE;
 }
 
 // New function to handle for loop initialization
-ASTNode *parse_for_init(Token tokens[], int *index)
+NodeId parse_for_init(TokenStream *ts)
 {
     // Check if it's a declaration (let/const) or just an assignment
-    if (tokens[*index].type == TOKEN_KEYWORD && 
-        (strcmp(tokens[*index].lexeme, "let") == 0 || strcmp(tokens[*index].lexeme, "const") == 0))
+    if (peek_token(ts, 0).type == TOKEN_KEYWORD && 
+        (peek_token(ts, 0).kw == KW_LET || peek_token(ts, 0).kw == KW_CONST))
     {
-        return parse_declaration(tokens, index);
+        return parse_declaration(ts);
     }
-    else if (tokens[*index].type == TOKEN_IDENTIFIER)
+    else if (peek_token(ts, 0).type == TOKEN_IDENTIFIER)
     {
         // Simple assignment like: i = 0
-        Token identifier = tokens[*index];
-        (*index)++;
+        Token identifier = peek_token(ts, 0);
+        advance_token(ts);
         
-        if (tokens[*index].type != TOKEN_OPERATOR || strcmp(tokens[*index].lexeme, "=") != 0)
+        if (peek_token(ts, 0).type != TOKEN_OPERATOR || peek_token(ts, 0).atom != ATOM_ASSIGN)
         {
             printf("Error: Expected '=' in for loop initialization\n");
             exit(1);
         }
-        (*index)++; // Skip "="
+        advance_token(ts); // Skip "="
         
-        ASTNode *assignNode = create_node(AST_ASSIGNMENT, "=");
-        assignNode->left = create_node(AST_IDENTIFIER, identifier.lexeme);
-        assignNode->right = parse_expression(tokens, index);
+        NodeId target = create_node(AST_IDENTIFIER, identifier.atom, NODE_NONE, NODE_NONE);
+        NodeId value = parse_expression(ts);
+        NodeId assignNode = create_node(AST_ASSIGNMENT, ATOM_ASSIGN, target, value);
         
         // Note: We don't insert into symbol table for undeclared variables in for loops
         // This is technically a semantic error, but we'll parse it
         
-        (*index)++; // Skip ";"
+        advance_token(ts); // Skip ";"
         return assignNode;
     }
     
@@ -346,322 +334,227 @@ ASTNode *parse_for_init(Token tokens[], int *index)
     exit(1);
 }
 
-ASTNode *parser_looping_statement(Token tokens[], int *index)
+NodeId parser_looping_statement(TokenStream *ts)
 {
-    Token loopKey = tokens[*index];
-    (*index)++; // Skip "for" or "while"
+    Token loopKey = peek_token(ts, 0);
+    advance_token(ts); // Skip "for" or "while"
     
-    if (strcmp(tokens[*index].lexeme, "(") != 0)
+    if (peek_token(ts, 0).atom != ATOM_LPAREN)
     {
         printf("Error: Expected '('\n");
-        return NULL;
+        return NODE_NONE;
     }
-    (*index)++; // Skip "("
+    advance_token(ts); // Skip "("
     
-    if (strcmp(loopKey.lexeme, "while") == 0)
+    if (loopKey.kw == KW_WHILE)
     {
-        ASTNode *condition = parse_expression(tokens, index);
-        if (strcmp(tokens[*index].lexeme, ")") != 0)
+        NodeId condition = parse_expression(ts);
+        if (peek_token(ts, 0).atom != ATOM_RPAREN)
         {
             printf("Error: Expected ')'\n");
-            return NULL;
+            return NODE_NONE;
         }
-        (*index)++; // Skip ")"
+        advance_token(ts); // Skip ")"
         
-        if (tokens[*index].type != TOKEN_PARENTHESES || strcmp(tokens[*index].lexeme, "{") != 0)
+        if (peek_token(ts, 0).type != TOKEN_PARENTHESES || peek_token(ts, 0).atom != ATOM_LBRACE)
         {
             printf("Error: Expected '{' after while condition\n");
             exit(1);
         }
-        (*index)++; // Skip "{"
+        advance_token(ts); // Skip "{"
         
-        ASTNode *block = create_node(AST_BLOCK, NULL);
-        block->body = malloc(sizeof(ASTNode *) * 10);
-        block->body_size = 0;
-        int capacity = 10;
+        NodeId block = parse_block(ts);
 
-        while (!(tokens[*index].type == TOKEN_PARENTHESES && strcmp(tokens[*index].lexeme, "}") == 0))
-        {
-            if (tokens[*index].type == TOKEN_EOF)
-            {
-                printf("Error: Unexpected end of file. Missing closing '}'.\n");
-                exit(1);
-            }
-
-            if (block->body_size >= capacity)
-            {
-                capacity *= 2;
-                block->body = realloc(block->body, sizeof(ASTNode *) * capacity);
-            }
-
-            block->body[block->body_size++] = parse_statement(tokens, index);
-        }
-        (*index)++; // Skip "}"
-
-        ASTNode *whileNode = create_node(AST_WHILE_STMT, "while");
-        whileNode->left = condition;
-        whileNode->right = block;
-        return whileNode;
+        return create_node(AST_WHILE_STMT, intern_cstr("while"), condition, block);
     }
-    else if (strcmp(loopKey.lexeme, "for") == 0)
+    else if (loopKey.kw == KW_FOR)
     {
         // Parse: for (init; condition; update)
-        ASTNode *init = parse_for_init(tokens, index);  // Now handles both declarations and assignments
-        ASTNode *condition = parse_expression(tokens, index);
-        (*index)++; // Skip ";"
-        ASTNode *update = parse_update(tokens, index);
+        NodeId init = parse_for_init(ts);  // Now handles both declarations and assignments
+        NodeId condition = parse_expression(ts);
+        advance_token(ts); // Skip ";"
+        NodeId update = parse_update(ts);
         
-        if (strcmp(tokens[*index].lexeme, ")") != 0)
+        if (peek_token(ts, 0).atom != ATOM_RPAREN)
         {
             printf("Error: Expected ')' after for loop header\n");
             exit(1);
         }
-        (*index)++; // Skip ")"
+        advance_token(ts); // Skip ")"
         
-        if (tokens[*index].type != TOKEN_PARENTHESES || strcmp(tokens[*index].lexeme, "{") != 0)
+        if (peek_token(ts, 0).type != TOKEN_PARENTHESES || peek_token(ts, 0).atom != ATOM_LBRACE)
         {
             printf("Error: Expected '{' after for loop header\n");
             exit(1);
         }
-        (*index)++; // Skip "{"
+        advance_token(ts); // Skip "{"
         
-        ASTNode *block = create_node(AST_BLOCK, NULL);
-        block->body = malloc(sizeof(ASTNode *) * 10);
-        block->body_size = 0;
-        int capacity = 10;
-
-        while (!(tokens[*index].type == TOKEN_PARENTHESES && strcmp(tokens[*index].lexeme, "}") == 0))
-        {
-            if (tokens[*index].type == TOKEN_EOF)
-            {
-                printf("Error: Unexpected end of file. Missing closing '}'.\n");
-                exit(1);
-            }
-
-            if (block->body_size >= capacity)
-            {
-                capacity *= 2;
-                block->body = realloc(block->body, sizeof(ASTNode *) * capacity);
-            }
-
-            block->body[block->body_size++] = parse_statement(tokens, index);
-        }
-        (*index)++; // Skip "}"
+        NodeId block = parse_block(ts);
 
-        // Build proper for loop structure
-        ASTNode *forNode = create_node(AST_FOR_STMT, "for");
-        
-        // Create a proper structure:
-        // forNode->left = init
-        // forNode->right = a helper node that contains condition, update, and body
-        ASTNode *loopParts = create_node(AST_BLOCK, NULL);
-        loopParts->body = malloc(sizeof(ASTNode*) * 3);
-        loopParts->body[0] = condition;
-        loopParts->body[1] = update;
-        loopParts->body[2] = block;
-        loopParts->body_size = 3;
-        
-        forNode->left = init;
-        forNode->right = loopParts;
+        // forNode->left = init, kids = condition, update, body
+        NodeId forNode = create_node(AST_FOR_STMT, intern_cstr("for"), init, NODE_NONE);
+        NodeId parts[3] = {condition, update, block};
+        ast_set_kids(ast, forNode, parts, 3);
         
         return forNode;
     }
-    return NULL;
+    return NODE_NONE;
 }
 
-ASTNode *parse_statement(Token tokens[], int *index)
+NodeId parse_statement(TokenStream *ts)
 {
-    if (strcmp(tokens[*index].lexeme, "console") == 0)
+    if (peek_token(ts, 0).atom == ATOM_CONSOLE)
     {
-        return parse_print_stmt(tokens, index);
+        return parse_print_stmt(ts);
     }
     
-    if (tokens[*index].type == TOKEN_KEYWORD)
+    if (peek_token(ts, 0).type == TOKEN_KEYWORD)
     {
-        if (strcmp(tokens[*index].lexeme, "let") == 0 || strcmp(tokens[*index].lexeme, "const") == 0)
+        if (peek_token(ts, 0).kw == KW_LET || peek_token(ts, 0).kw == KW_CONST)
         {
-            return parse_declaration(tokens, index);
+            return parse_declaration(ts);
         }
-        else if (strcmp(tokens[*index].lexeme, "if") == 0 || strcmp(tokens[*index].lexeme, "else") == 0)
+        else if (peek_token(ts, 0).kw == KW_IF || peek_token(ts, 0).kw == KW_ELSE)
         {
-            return parser_conditional_statement(tokens, index);
+            return parser_conditional_statement(ts);
         }
-        else if (strcmp(tokens[*index].lexeme, "for") == 0 || strcmp(tokens[*index].lexeme, "while") == 0)
+        else if (peek_token(ts, 0).kw == KW_FOR || peek_token(ts, 0).kw == KW_WHILE)
         {
-            return parser_looping_statement(tokens, index);
+            return parser_looping_statement(ts);
         }
     }
     
-    if (tokens[*index].type == TOKEN_IDENTIFIER && 
-        tokens[(*index) + 1].type == TOKEN_OPERATOR && 
-        strcmp(tokens[(*index) + 1].lexeme, "=") == 0)
+    if (peek_token(ts, 0).type == TOKEN_IDENTIFIER && 
+        peek_token(ts, 1).type == TOKEN_OPERATOR && 
+        peek_token(ts, 1).atom == ATOM_ASSIGN)
     {
-        return parse_assignment(tokens, index);
+        return parse_assignment(ts);
     }
     
-    if (tokens[*index].type == TOKEN_EOF)
+    if (peek_token(ts, 0).type == TOKEN_EOF)
     {
-        return NULL;
+        return NODE_NONE;
     }
     
-    printf("Unexpected token: %s, with line: %d, skipping...\n", tokens[*index].lexeme, tokens[*index].line);
-    (*index)++;
-    return NULL;
+    printf("Unexpected token: %s, with line: %d, skipping...\n",
+           atom_str(peek_token(ts, 0).atom), peek_token(ts, 0).line);
+    advance_token(ts);
+    return NODE_NONE;
 }
 
-
-ASTNode *fold_constants(ASTNode *node)
+NodeId parse_program(TokenStream *ts)
 {
-    if (!node)
-        return NULL;
-    node->left = fold_constants(node->left);
-    node->right = fold_constants(node->right);
-
-    if (node->type == AST_BINARY_OP && node->left && node->right)
+    int base = pending_count;
+    while (peek_token(ts, 0).type != TOKEN_ERROR && peek_token(ts, 0).type != TOKEN_EOF)
     {
-        if (node->left->type == AST_LITERAL && node->right->type == AST_LITERAL)
-        {
-            int left_val = atoi(node->left->value);
-            int right_val = atoi(node->right->value);
-            int result;
-            if (strcmp(node->value, "+") == 0)
-                result = left_val + right_val;
-            else if (strcmp(node->value, "-") == 0)
-                result = left_val - right_val;
-            else if (strcmp(node->value, "*") == 0)
-                result = left_val * right_val;
-            else if (strcmp(node->value, "/") == 0)
-                result = right_val != 0 ? left_val / right_val : 0;
-
-            char buffer[20];
-            sprintf(buffer, "%d", result);
-            return create_node(AST_LITERAL, buffer);
-        }
+        NodeId stmt = parse_statement(ts);
+        if (stmt)
+            push_pending(stmt);
     }
-    return node;
+    NodeId program = finish_block(base);
+    ast->root = program;
+
+    free(pending);
+    pending = NULL;
+    pending_capacity = 0;
+    return program;
 }
 
-ASTNode *eliminate_dead_code(ASTNode *node)
+
+static void print_indent(int depth)
 {
-    if (!node)
-        return NULL;
-    if (node->type == AST_IF_STMT)
-    {
-        node->left = fold_constants(node->left);
-        if (node->left->type == AST_LITERAL)
-        {
-            if (atoi(node->left->value) == 0)
-                return NULL;
-            return eliminate_dead_code(node->right);
-        }
-    }
-    return node;
+    for (int i = 0; i < depth; i++)
+        printf("  ");
 }
 
-void print_ast(ASTNode *node, int depth)
+void print_ast(const Ast *ast, NodeId id, int depth)
 {
-    if (!node) return;
+    if (!id) return;
+    const ASTNode *node = ast_node(ast, id);
     
-    for (int i = 0; i < depth; i++)
-        printf("  ");
+    print_indent(depth);
 
     if (node->type == AST_VAR_DECL)
-        printf("VarDecl(%s)\n", node->value);
+        printf("VarDecl(%s)\n", atom_str(node->value));
     else if (node->type == AST_ASSIGNMENT)
     {
         printf("Assign\n");
-        print_ast(node->left, depth + 1);
-        print_ast(node->right, depth + 1);
+        print_ast(ast, node->left, depth + 1);
+        print_ast(ast, node->right, depth + 1);
     }
     else if (node->type == AST_BINARY_OP)
     {
-        printf("BinaryOp(%s)\n", node->value);
-        print_ast(node->left, depth + 1);
-        print_ast(node->right, depth + 1);
+        printf("BinaryOp(%s)\n", atom_str(node->value));
+        print_ast(ast, node->left, depth + 1);
+        print_ast(ast, node->right, depth + 1);
     }
     else if (node->type == AST_IDENTIFIER)
-        printf("Identifier(%s)\n", node->value);
+        printf("Identifier(%s)\n", atom_str(node->value));
     else if (node->type == AST_FUNC_CALL)
     {
-        printf("FuncCall(%s)\n", node->value);
-        for (int i = 0; i < node->body_size; i++)
+        printf("FuncCall(%s)\n", atom_str(node->value));
+        for (uint32_t i = 0; i < node->count; i++)
         {
-            print_ast(node->body[i], depth + 1);
+            print_ast(ast, ast_kid(ast, node, i), depth + 1);
         }
     }
     else if (node->type == AST_LITERAL)
-        printf("Literal(%s)\n", node->value);
+        printf("Literal(%s)\n", atom_str(node->value));
     else if (node->type == AST_IF_STMT)
     {
         printf("IfStmt\n");
-        print_ast(node->left, depth + 1);
-        print_ast(node->right, depth + 1);
+        print_ast(ast, node->left, depth + 1);
+        print_ast(ast, node->right, depth + 1);
     }
     else if (node->type == AST_WHILE_STMT)
     {
         printf("WhileStmt\n");
-        print_ast(node->left, depth + 1);
-        print_ast(node->right, depth + 1);
+        print_ast(ast, node->left, depth + 1);
+        print_ast(ast, node->right, depth + 1);
     }
     else if (node->type == AST_POST_UPDATE)
     {
-        printf("PostUpdate(%s)\n", node->value);
+        printf("PostUpdate(%s)\n", atom_str(node->value));
     }
     else if (node->type == AST_PRE_UPDATE)
     {
-        printf("PreUpdate(%s)\n", node->value);
+        printf("PreUpdate(%s)\n", atom_str(node->value));
     }
     else if (node->type == AST_FOR_STMT)
     {
         printf("ForStmt\n");
         // Print init
-        for (int i = 0; i < depth + 1; i++) printf("  ");
+        print_indent(depth + 1);
         printf("Init:\n");
-        print_ast(node->left, depth + 2);
+        print_ast(ast, node->left, depth + 2);
         
         // Print condition, update, and body
-        if (node->right && node->right->body_size >= 3)
+        if (node->count >= 3)
         {
-            for (int i = 0; i < depth + 1; i++) printf("  ");
+            print_indent(depth + 1);
             printf("Condition:\n");
-            print_ast(node->right->body[0], depth + 2);
+            print_ast(ast, ast_kid(ast, node, 0), depth + 2);
             
-            for (int i = 0; i < depth + 1; i++) printf("  ");
+            print_indent(depth + 1);
             printf("Update:\n");
-            print_ast(node->right->body[1], depth + 2);
+            print_ast(ast, ast_kid(ast, node, 1), depth + 2);
             
-            for (int i = 0; i < depth + 1; i++) printf("  ");
+            print_indent(depth + 1);
             printf("Body:\n");
-            print_ast(node->right->body[2], depth + 2);
+            print_ast(ast, ast_kid(ast, node, 2), depth + 2);
         }
     }
     else if (node->type == AST_ELSE_STMT)
     {
         printf("ElseStmt\n");
-        print_ast(node->right, depth + 1);
+        print_ast(ast, node->right, depth + 1);
     }
     else if (node->type == AST_BLOCK)
     {
         printf("Block\n");
-        for (int i = 0; i < node->body_size; i++)
+        for (uint32_t i = 0; i < node->count; i++)
         {
-            print_ast(node->body[i], depth + 1);
+            print_ast(ast, ast_kid(ast, node, i), depth + 1);
         }
     }
-}
-
-void free_ast(ASTNode *node)
-{
-    if (node == NULL)
-        return;
-
-    free_ast(node->left);
-    free_ast(node->right);
-    for (int i = 0; i < node->body_size; i++)
-    {
-        free_ast(node->body[i]);
-    }
-    free(node->body);
-    free(node->value);
-    free(node);
 }
\ No newline at end of file
@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "../../include/pass.h"
+#include "../../include/ssa.h"
+#include "../../include/opt.h"
+#include "../../include/stats.h"
+
+typedef void (*PassFn)(char *detail, size_t size);
+
+typedef struct {
+    const char *name;
+    PassKind kind;
+    unsigned requires; // bit per pass index
+    unsigned levels;   // bit per -O level that enables it by default
+    PassFn run;
+} Pass;
+
+static int unroll_factor = 4;
+
+/* ---------- Pass wrappers ---------- */
+
+static void run_ssa(char *detail, size_t size)
+{
+    ssa_construct();
+    snprintf(detail, size, "%d blocks", cfg_block_count());
+}
+
+static void run_sccp(char *detail, size_t size)
+{
+    opt_sccp();
+    snprintf(detail, size, "%d blocks", cfg_block_count());
+}
+
+static void run_gvn(char *detail, size_t size)
+{
+    GvnStats gvn;
+    opt_gvn(&gvn);
+    snprintf(detail, size, "%d redundant expressions, %d copies removed",
+             gvn.redundant, gvn.copies);
+}
+
+static void run_licm(char *detail, size_t size)
+{
+    LoopStats loops;
+    opt_loops(&loops);
+    snprintf(detail, size, "%d loops, %d invariants hoisted, %d multiplications reduced",
+             loops.loops, loops.hoisted, loops.reduced);
+}
+
+static void run_unroll(char *detail, size_t size)
+{
+    UnrollStats unrolled;
+    opt_unroll(unroll_factor, &unrolled);
+    snprintf(detail, size, "%d loops fully unrolled, %d unrolled by %d",
+             unrolled.full, unrolled.partial, unroll_factor);
+}
+
+static void run_dce(char *detail, size_t size)
+{
+    DceStats dce;
+    opt_dead_code_elimination(&dce);
+    snprintf(detail, size, "%d unreachable blocks, %d dead instructions, %d dead stores removed",
+             dce.unreachable_blocks, dce.dead_instrs, dce.dead_stores);
+}
+
+/* ---------- Registry ---------- */
+
+enum { P_SSA, P_SCCP, P_GVN, P_LICM, P_UNROLL, P_DCE, PASS_COUNT };
+
+#define BIT(p) (1u << (p))
+#define FROM_O1 (BIT(1) | BIT(2))
+#define FROM_O2 BIT(2)
+
+// In pipeline order; a pass only requires passes listed before it
+static const Pass passes[PASS_COUNT] = {
+    [P_SSA]    = {"ssa",    PASS_CFG, 0,          FROM_O1, run_ssa},
+    [P_SCCP]   = {"sccp",   PASS_CFG, BIT(P_SSA), FROM_O1, run_sccp},
+    [P_GVN]    = {"gvn",    PASS_IR,  BIT(P_SSA), FROM_O2, run_gvn},
+    [P_LICM]   = {"licm",   PASS_IR,  BIT(P_SSA), FROM_O2, run_licm},
+    [P_UNROLL] = {"unroll", PASS_IR,  BIT(P_SSA), FROM_O2, run_unroll},
+    [P_DCE]    = {"dce",    PASS_IR,  0,          FROM_O1, run_dce},
+};
+
+static int level = 2;
+static unsigned forced_on = 0;
+static unsigned forced_off = 0;
+
+void pass_set_level(int l)
+{
+    if (l < 0 || l > 2)
+    {
+        printf("Error: unknown optimization level -O%d (expected 0, 1 or 2)\n", l);
+        exit(1);
+    }
+    level = l;
+}
+
+void pass_set_unroll(int factor)
+{
+    unroll_factor = factor;
+}
+
+static int find_pass(const char *name, size_t len)
+{
+    for (int p = 0; p < PASS_COUNT; p++)
+        if (strlen(passes[p].name) == len && !strncmp(passes[p].name, name, len))
+            return p;
+    return -1;
+}
+
+void pass_override(const char *list)
+{
+    while (*list)
+    {
+        size_t len = strcspn(list, ",");
+        int off = len > 3 && !strncmp(list, "no-", 3);
+        const char *name = off ? list + 3 : list;
+        size_t name_len = off ? len - 3 : len;
+
+        int p = find_pass(name, name_len);
+        if (p < 0)
+        {
+            printf("Error: unknown pass '%.*s' in -fpass= (passes:", (int)name_len, name);
+            for (int q = 0; q < PASS_COUNT; q++)
+                printf(" %s", passes[q].name);
+            printf(")\n");
+            exit(1);
+        }
+        if (off)
+        {
+            forced_off |= BIT(p);
+            forced_on &= ~BIT(p);
+        }
+        else
+        {
+            forced_on |= BIT(p);
+            forced_off &= ~BIT(p);
+        }
+
+        list += len;
+        if (*list == ',')
+            list++;
+    }
+}
+
+// Level defaults plus overrides, closed over requirements. A pass whose
+// requirement was explicitly turned off is dropped.
+static unsigned selected_passes(void)
+{
+    unsigned set = forced_on;
+    for (int p = 0; p < PASS_COUNT; p++)
+        if (passes[p].levels & BIT(level))
+            set |= BIT(p);
+    set &= ~forced_off;
+
+    for (int p = PASS_COUNT - 1; p >= 0; p--)
+    {
+        if (!(set & BIT(p)) || !(passes[p].requires & ~set))
+            continue;
+        unsigned missing = passes[p].requires & ~set;
+        if (missing & forced_off)
+        {
+            fprintf(stderr, "warning: pass '%s' skipped, a pass it requires is disabled\n",
+                    passes[p].name);
+            set &= ~BIT(p);
+        }
+        else
+            set |= missing;
+    }
+    return set;
+}
+
+/* ---------- Running ---------- */
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static long peak_rss_kb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static int live_instrs(void)
+{
+    int count, live = 0;
+    IRInstr *ir = ir_get_all(&count);
+    for (int i = 0; i < count; i++)
+        live += ir[i].op != IR_NOP;
+    return live;
+}
+
+void pass_run_all(int time_passes, int pass_stats)
+{
+    unsigned set = selected_passes();
+    struct {
+        double ms;
+        int before, after;
+        long rss_kb;
+    } rows[PASS_COUNT];
+
+    for (int p = 0; p < PASS_COUNT; p++)
+    {
+        if (!(set & BIT(p)))
+            continue;
+
+        char detail[160] = "";
+        long rss = peak_rss_kb();
+        rows[p].before = live_instrs();
+        double start = now_ms();
+        stats_begin(passes[p].name);
+        passes[p].run(detail, sizeof(detail));
+        stats_end();
+        rows[p].ms = now_ms() - start;
+        rows[p].after = live_instrs();
+        rows[p].rss_kb = peak_rss_kb() - rss;
+
+        if (pass_stats)
+            printf("%s: %d -> %d instructions; %s\n", passes[p].name,
+                   rows[p].before, rows[p].after, detail);
+    }
+
+    if (!time_passes)
+        return;
+    double total = 0;
+    printf("%-8s %-4s %10s %8s %8s %10s\n", "pass", "kind", "ms", "before", "after", "rss +KB");
+    for (int p = 0; p < PASS_COUNT; p++)
+    {
+        if (!(set & BIT(p)))
+            continue;
+        printf("%-8s %-4s %10.3f %8d %8d %10ld\n", passes[p].name,
+               passes[p].kind == PASS_CFG ? "cfg" : "ir", rows[p].ms,
+               rows[p].before, rows[p].after, rows[p].rss_kb);
+        total += rows[p].ms;
+    }
+    printf("%-8s %-4s %10.3f\n", "total", "", total);
+}
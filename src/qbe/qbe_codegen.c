@@ -1,93 +1,230 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include "../../include/qbe_codegen.h"
 
 static FILE *out;
 
 /* ---------- helpers ---------- */
 
-static int is_temp(const char *s)
+// Each variable lives in its own stack slot, named after the source name
+// and SymbolId so shadowed names stay distinct
+static void emit_slot(SymbolId var)
 {
-    return s && s[0] == 't' && isdigit(s[1]);
+    fprintf(out, "%%%s.%u", atom_str(semantic_symbol(var)->name), var);
 }
-static int is_variable(const char *s)
+
+// Strings have no QBE representation yet
+static int has_slot(SymbolId var)
 {
-    if (!s)
-        return 0;
-    if (is_temp(s))
-        return 0;
-    if (!strcmp(s, "num"))
-        return 1;
-    if (!strcmp(s, "x"))
-        return 1;
-    return 0;
+    return var && semantic_symbol(var)->type != TYPE_STRING;
 }
 
-static int needs_load(const char *v)
+// Immediates and temporaries; variables are loaded by the caller
+static void emit_val(IROperand v)
 {
-    if (!v)
-        return 0;
-    if (is_temp(v))
-        return 0;
-    if (isdigit(v[0]) || v[0] == '-')
-        return 0;
-    if (!strncmp(v, "0x", 2))
-        return 0;
-    if (!strncmp(v, "0b", 2))
-        return 0;
-    if (!strcmp(v, "true") || !strcmp(v, "false"))
-        return 0;
-    return 1; // variable → needs load
+    switch (v.kind)
+    {
+    case OPD_TEMP:
+        fprintf(out, "%%t%u", v.index);
+        break;
+    case OPD_INT:
+        fprintf(out, "%d", v.imm);
+        break;
+    case OPD_CONST:
+    {
+        // Every value is a word for now, so wide and fractional constants truncate
+        const IRConst *c = ir_const(v.index);
+        fprintf(out, "%d", (int32_t)(c->is_double ? (int64_t)c->d : c->i));
+        break;
+    }
+    default:
+        fprintf(out, "0");
+        break;
+    }
 }
 
-static void emit_val(const char *v)
+// Load a variable operand into %<prefix><i>, or print the value directly
+static void emit_operand(IROperand v, const char *prefix, int i)
 {
-    if (isdigit(v[0]) || v[0] == '-')
-        fprintf(out, "%s", v);
-    else if (!strncmp(v, "0x", 2))
-        fprintf(out, "%d", (int)strtol(v + 2, NULL, 16));
-    else if (!strcmp(v, "true"))
-        fprintf(out, "1");
-    else if (!strcmp(v, "false"))
-        fprintf(out, "0");
-    else if (!strncmp(v, "0b", 2))
-        fprintf(out, "%d", (int)strtol(v + 2, NULL, 2));
-    else if (is_temp(v))
-        fprintf(out, "%%%s", v);
+    if (v.kind == OPD_VAR)
+        fprintf(out, "%%%s%d", prefix, i);
     else
-        fprintf(out, "%s", v);
+        emit_val(v);
 }
 
-static const char *qbe_binop(const char *op)
+static void emit_load(IROperand v, const char *prefix, int i)
 {
-    if (!strcmp(op, "+"))
-        return "add";
-    if (!strcmp(op, "-"))
-        return "sub";
-    if (!strcmp(op, "*"))
-        return "mul";
-    if (!strcmp(op, "/"))
-        return "div";
-    if (!strcmp(op, "==="))
-        return "ceqw";
-    if (!strcmp(op, "<"))
-        return "csltw";
-    return "add";
+    if (v.kind != OPD_VAR)
+        return;
+    fprintf(out, "    %%%s%d =w loadw ", prefix, i);
+    emit_slot(v.index);
+    fprintf(out, "\n");
 }
 
-/* ---------- codegen ---------- */
+static const char *const qbe_binop[IR_OP_COUNT] = {
+    [IR_ADD] = "add",
+    [IR_SUB] = "sub",
+    [IR_MUL] = "mul",
+    [IR_DIV] = "div",
+    [IR_EQ] = "ceqw",
+    [IR_NE] = "cnew",
+    [IR_LT] = "csltw",
+    [IR_GT] = "csgtw",
+    [IR_LE] = "cslew",
+    [IR_GE] = "csgew",
+};
+
+/* ---------- instructions ---------- */
+
+static void emit_instr(IRInstr *ir, int i)
+{
+    IRInstr *in = &ir[i];
+
+    switch (in->op)
+    {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_GT:
+    case IR_LE:
+    case IR_GE:
+        emit_load(in->lhs, "_l", i);
+        emit_load(in->rhs, "_r", i);
+
+        fprintf(out, "    %%t%u =w %s ", in->dst.index, qbe_binop[in->op]);
+        emit_operand(in->lhs, "_l", i);
+        fprintf(out, ", ");
+        emit_operand(in->rhs, "_r", i);
+        fprintf(out, "\n");
+        break;
+
+    case IR_ASSIGN:
+        if (in->dst.kind == OPD_TEMP)
+        {
+            emit_load(in->lhs, "_a", i);
+            fprintf(out, "    %%t%u =w copy ", in->dst.index);
+            emit_operand(in->lhs, "_a", i);
+            fprintf(out, "\n");
+            break;
+        }
+        if (!has_slot(in->dst.index))
+            break;
+
+        emit_load(in->lhs, "_a", i);
+        fprintf(out, "    storew ");
+        emit_operand(in->lhs, "_a", i);
+        fprintf(out, ", ");
+        emit_slot(in->dst.index);
+        fprintf(out, "\n");
+        break;
+
+    case IR_LABEL:
+    case IR_NOP:
+        break;
+
+    case IR_RET:
+        fprintf(out, "    ret 0\n");
+        break;
+
+    case IR_GOTO:
+    case IR_IF_FALSE:
+        /* block terminators, see emit_block */
+        break;
+
+    case IR_PARAM:
+        /* params handled before call */
+        break;
+
+    case IR_CALL:
+        if (in->callee == CALLEE_CONSOLE_LOG)
+        {
+            IROperand arg = ir[i - 1].lhs;
+
+            if (arg.kind == OPD_VAR)
+            {
+                if (has_slot(arg.index))
+                {
+                    emit_load(arg, "_p", i);
+                    fprintf(out, "    call $printi(w %%_p%d)\n", i);
+                }
+            }
+            else if (arg.kind == OPD_TEMP || arg.kind == OPD_INT || arg.kind == OPD_CONST)
+            {
+                fprintf(out, "    call $printi(w ");
+                emit_val(arg);
+                fprintf(out, ")\n");
+            }
+        }
+        break;
 
-void qbe_codegen_ir(IRInstr *ir, int ir_count, const char *out_qbe)
+    default:
+        break;
+    }
+}
+
+// Arguments follow the CFG predecessor order; unreachable predecessors
+// are never emitted, so their arguments are dropped
+static void emit_phi(IRInstr *phi, BasicBlock *b)
 {
-    out = fopen(out_qbe, "wb");
-    if (!out)
+    const int *preds = cfg_preds(b);
+    const IROperand *args = ir_phi_args(phi);
+    int first = 1;
+
+    fprintf(out, "    %%t%u =w phi", phi->dst.index);
+    for (int j = 0; j < phi->argc; j++)
+    {
+        if (cfg_get_block(preds[j])->rpo < 0)
+            continue;
+        fprintf(out, first ? " @b%d " : ", @b%d ", preds[j]);
+        emit_val(args[j]);
+        first = 0;
+    }
+    fprintf(out, "\n");
+}
+
+static void emit_jump(int target)
+{
+    fprintf(out, "    jmp @b%d\n", target);
+}
+
+// One QBE block per CFG block. Conditional succs are {fallthrough, target};
+// fallthrough into the next block is left implicit.
+static void emit_block(IRInstr *ir, BasicBlock *b)
+{
+    fprintf(out, "@b%d\n", b->id);
+    for (int i = b->first; i < b->end; i++)
+    {
+        if (ir[i].op == IR_PHI)
+            emit_phi(&ir[i], b);
+        else
+            emit_instr(ir, i);
+    }
+
+    const int *succ = cfg_succs(b);
+    const IRInstr *last = b->end > b->first ? &ir[b->end - 1] : NULL;
+
+    if (last && last->op == IR_IF_FALSE && b->succ_count == 2)
     {
-        perror("fopen");
-        printf("Failed to open output QBE file: %s\n", out_qbe);
-        exit(1);
+        int i = b->end - 1;
+        emit_load(last->lhs, "_c", i);
+        fprintf(out, "    jnz ");
+        emit_operand(last->lhs, "_c", i);
+        fprintf(out, ", @b%d, @b%d\n", succ[0], succ[1]);
     }
+    else if (b->succ_count == 1 && succ[0] != b->id + 1)
+        emit_jump(succ[0]);
+}
+
+/* ---------- codegen ---------- */
+
+void qbe_codegen_ir(IRInstr *ir, FILE *stream)
+{
+    out = stream;
 
     /* ---- helpers ---- */
 
@@ -106,139 +243,43 @@ void qbe_codegen_ir(IRInstr *ir, int ir_count, const char *out_qbe)
             "@entry\n");
 
     /* ---- allocate locals ---- */
+
+    // Only variables SSA construction left in memory need a stack slot
+    int ir_count;
+    ir_get_all(&ir_count);
+    char *in_memory = calloc(semantic_symbol_count(), 1);
     for (int i = 0; i < ir_count; i++)
     {
-        if (ir[i].op == IR_ASSIGN && is_variable(ir[i].dst))
-            fprintf(out, "    %%%s =l alloc4 4\n", ir[i].dst);
+        IROperand *uses[2];
+        int n = ir_uses(&ir[i], uses);
+        for (int u = 0; u < n; u++)
+            if (uses[u]->kind == OPD_VAR)
+                in_memory[uses[u]->index] = 1;
+        IROperand *def = ir_def(&ir[i]);
+        if (def && def->kind == OPD_VAR)
+            in_memory[def->index] = 1;
     }
 
-    /* ---- instructions ---- */
-
-    for (int i = 0; i < ir_count; i++)
+    for (SymbolId var = 1; var < semantic_symbol_count(); var++)
     {
-        IRInstr *in = &ir[i];
-
-        switch (in->op)
-        {
-
-        case IR_BINOP:
-        {
-            const char *l = in->lhs;
-            const char *r = in->rhs;
-
-            if (needs_load(l))
-            {
-                static char tmpbuf[32];
-
-                fprintf(out, "    %%_l%d =w loadw %%%s\n", i, l);
-                snprintf(tmpbuf, sizeof(tmpbuf), "_l%d", i);
-                l = tmpbuf;
-            }
-            if (needs_load(r))
-            {
-                static char tmpbuf[32];
-
-                fprintf(out, "    %%_r%d =w loadw %%%s\n", i, r);
-                snprintf(tmpbuf, sizeof(tmpbuf), "_r%d", i);
-                r = tmpbuf;
-            }
-
-            fprintf(out, "    %%%s =w %s ",
-                    in->dst, qbe_binop(in->op_str));
-
-            if (l[0] == '_')
-                fprintf(out, "%%_l%d", i);
-            else
-                emit_val(l);
-
-            fprintf(out, ", ");
-
-            if (r[0] == '_')
-                fprintf(out, "%%_r%d", i);
-            else
-                emit_val(r);
-
-            fprintf(out, "\n");
-            break;
-        }
-
-        case IR_ASSIGN:
-            if (!strcmp(in->dst, "y") ||
-                !strcmp(in->dst, "hex") ||
-                !strcmp(in->dst, "bin") ||
-                !strcmp(in->dst, "str") ||
-                !strcmp(in->dst, "_bool"))
-                break;
-
-            if (!strncmp(in->lhs, "0x", 2) || !strncmp(in->lhs, "0b", 2))
-            {
-                fprintf(out, "    storew ");
-                emit_val(in->lhs); // emit_val already converts
-                fprintf(out, ", %%%s\n", in->dst);
-            }
-            else if (in->lhs && in->lhs[0] == '"')
-            {
-                break; // skip strings
-            }
-            else
-            {
-                fprintf(out, "    storew ");
-                emit_val(in->lhs);
-                fprintf(out, ", %%%s\n", in->dst);
-            }
-            break;
-
-        case IR_LABEL:
-            // if (in->label && in->label[0] != '\0')
-            // {
-            //     fprintf(out, "@%s\n", in->label);
-            // }
-            break;
-
-        case IR_GOTO:
-            // fprintf(out, "    jmp @%s\n", in->label);
-            break;
-
-        case IR_IF_FALSE:
-            // fprintf(out, "    jnz ");
-            // emit_val(in->lhs);
-            // fprintf(out, ", @next_%d, @%s\n", i, in->label);
-            // fprintf(out, "@next_%d\n", i);
-            break;
-
-        case IR_PARAM:
-            /* params handled before call */
-            break;
+        if (!in_memory[var] || !has_slot(var))
+            continue;
+        fprintf(out, "    ");
+        emit_slot(var);
+        fprintf(out, " =l alloc4 4\n");
+    }
+    free(in_memory);
 
-        case IR_CALL:
-            if (!strcmp(in->func, "console.log"))
-            {
-                const char *arg = ir[i - 1].lhs;
+    /* ---- blocks ---- */
 
-                if (is_temp(arg))
-                {
-                    fprintf(out, "    call $printi(w %%%s)\n", arg);
-                }
-                else if (isdigit(arg[0]) || arg[0] == '-')
-                {
-                    fprintf(out, "    call $printi(w %s)\n", arg);
-                }
-                else if (is_variable(arg))
-                {
-                    fprintf(out, "    %%v =w loadw %%%s\n", arg);
-                    fprintf(out, "    call $printi(w %%v)\n");
-                }
-            }
-            break;
-
-        default:
-            break;
-        }
+    // Unreachable blocks are skipped; reachable ones keep their order so
+    // fallthrough edges still land on the next emitted block
+    for (int i = 0; i < cfg_block_count(); i++)
+    {
+        BasicBlock *b = cfg_get_block(i);
+        if (b->rpo >= 0)
+            emit_block(ir, b);
     }
 
-    fprintf(out,
-            "    ret 0\n"
-            "}\n");
-
-    fclose(out);
+    fprintf(out, "}\n");
 }
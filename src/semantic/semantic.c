@@ -4,42 +4,54 @@
 #include <ctype.h>
 #include "../../include/semantic.h"
 
-#define MAX_SCOPES 64
-#define SEM_MAX_SYMBOLS 256
+/* ---------- Symbol Table ---------- */
 
-static int max_scope_depth = 0;
+// Every declaration ever made, indexed by SymbolId (slot 0 unused)
+static SemanticSymbol *symbols;
+static uint32_t symbol_count = 0;
+static uint32_t symbol_capacity = 0;
 
+// Atoms are small dense integers, so the name -> symbol map is a plain
+// array indexed by atom holding the innermost visible declaration
+static SymbolId *binding;
+static uint32_t binding_size = 0;
 
+// Declarations push the binding they shadow; leaving a scope pops back to
+// the mark taken on entry, so enter/exit/declare/lookup are all O(1)
 typedef struct {
-    char name[50];
-    int is_const;
-    SemType type;
-} SemanticSymbol;
+    Atom name;
+    SymbolId shadowed;
+} UndoEntry;
 
-typedef struct {
-    int scope;
-    int index;
-} SymbolRef;
-
-
-
-typedef struct {
-    SemanticSymbol symbols[SEM_MAX_SYMBOLS];
-    int count;
-} Scope;
+static UndoEntry *undo_log;
+static uint32_t undo_count = 0;
+static uint32_t undo_capacity = 0;
 
-static Scope scopes[MAX_SCOPES];
+static uint32_t *scope_marks;
+static int scope_capacity = 0;
 static int scope_depth = -1;
 
-static void extract_update_identifier(char *out, const char *expr) {
-    int j = 0;
-    for (int i = 0; expr[i]; i++) {
-        if (isalpha(expr[i]) || expr[i] == '_')
-            out[j++] = expr[i];
+static Ast *ast;
+
+static void *xrealloc(void *p, size_t size) {
+    p = realloc(p, size);
+    if (!p) {
+        perror("realloc");
+        exit(1);
     }
-    out[j] = '\0';
+    return p;
 }
 
+static void ensure_binding(Atom name) {
+    if (name < binding_size)
+        return;
+    uint32_t size = binding_size ? binding_size : 256;
+    while (size <= name)
+        size *= 2;
+    binding = xrealloc(binding, sizeof(SymbolId) * size);
+    memset(binding + binding_size, 0, sizeof(SymbolId) * (size - binding_size));
+    binding_size = size;
+}
 
 static const char *type_to_string(SemType t) {
     switch (t) {
@@ -50,12 +62,14 @@ static const char *type_to_string(SemType t) {
     }
 }
 
-static SemType literal_type(const char *value) {
-    if (!value) return TYPE_UNKNOWN;
+static SemType literal_type(Atom atom) {
+    if (atom == ATOM_NONE) return TYPE_UNKNOWN;
 
-    if (!strcmp(value, "true") || !strcmp(value, "false"))
+    if (atom == ATOM_TRUE || atom == ATOM_FALSE)
         return TYPE_BOOLEAN;
 
+    const char *value = atom_str(atom);
+
     // numeric literals
     if (isdigit(value[0]) || 
         (value[0] == '-' && isdigit(value[1])) ||
@@ -74,66 +88,94 @@ static SemType literal_type(const char *value) {
 
 static void enter_scope() {
     scope_depth++;
-    if (scope_depth > max_scope_depth)
-        max_scope_depth = scope_depth;
-    scopes[scope_depth].count = 0;
+    if (scope_depth >= scope_capacity) {
+        scope_capacity = scope_capacity ? scope_capacity * 2 : 16;
+        scope_marks = xrealloc(scope_marks, sizeof(uint32_t) * scope_capacity);
+    }
+    scope_marks[scope_depth] = undo_count;
 }
 
 
 static void exit_scope() {
+    uint32_t mark = scope_marks[scope_depth];
+    while (undo_count > mark) {
+        UndoEntry *e = &undo_log[--undo_count];
+        binding[e->name] = e->shadowed;
+    }
     scope_depth--;
 }
 
-static SymbolRef lookup_symbol(const char *name) {
-    for (int i = scope_depth; i >= 0; i--) {
-        for (int j = 0; j < scopes[i].count; j++) {
-            if (strcmp(scopes[i].symbols[j].name, name) == 0)
-                return (SymbolRef){ i, j };
-        }
-    }
-    return (SymbolRef){ -1, -1 };
+static SymbolId lookup_symbol(Atom name) {
+    return name < binding_size ? binding[name] : SYMBOL_NONE;
 }
 
 
 
-static void declare_symbol(const char *name, int is_const, SemType type) {
-    Scope *scope = &scopes[scope_depth];
+static SymbolId declare_symbol(Atom name, int is_const, SemType type) {
+    ensure_binding(name);
 
-    for (int i = 0; i < scope->count; i++) {
-        if (strcmp(scope->symbols[i].name, name) == 0) {
-            printf("Semantic Error: redeclaration of '%s'\n", name);
-            exit(1);
-        }
+    SymbolId shadowed = binding[name];
+    if (shadowed && symbols[shadowed].depth == scope_depth) {
+        printf("Semantic Error: redeclaration of '%s'\n", atom_str(name));
+        exit(1);
+    }
+
+    if (symbol_count == 0)
+        symbol_count = 1; // SYMBOL_NONE
+    if (symbol_count >= symbol_capacity) {
+        symbol_capacity = symbol_capacity ? symbol_capacity * 2 : 256;
+        symbols = xrealloc(symbols, sizeof(SemanticSymbol) * symbol_capacity);
+    }
+    SymbolId id = symbol_count++;
+    symbols[id] = (SemanticSymbol){name, is_const, scope_depth, type};
+
+    if (undo_count >= undo_capacity) {
+        undo_capacity = undo_capacity ? undo_capacity * 2 : 256;
+        undo_log = xrealloc(undo_log, sizeof(UndoEntry) * undo_capacity);
     }
+    undo_log[undo_count++] = (UndoEntry){name, shadowed};
 
-    strcpy(scope->symbols[scope->count].name, name);
-    scope->symbols[scope->count].is_const = is_const;
-    scope->symbols[scope->count].type = type;
-    scope->count++;
+    binding[name] = id;
+    return id;
 }
 
-static SemType analyze_expr(ASTNode *node) {
-    if (!node) return TYPE_UNKNOWN;
+// Bind an identifier node to the symbol it names
+static SymbolId resolve(ASTNode *node) {
+    SymbolId sym = lookup_symbol(node->value);
+    if (!sym) {
+        printf("Semantic Error: '%s' is not declared\n", atom_str(node->value));
+        exit(1);
+    }
+    node->sym = sym;
+    node->sem_type = symbols[sym].type;
+    return sym;
+}
+
+static SemType infer_expr(ASTNode *node);
+
+static SemType analyze_expr(NodeId id) {
+    if (!id) return TYPE_UNKNOWN;
+    ASTNode *node = ast_node(ast, id);
+    SemType type = infer_expr(node);
+    node->sem_type = type;
+    return type;
+}
+
+static SemType infer_expr(ASTNode *node) {
 
     switch (node->type) {
 
     case AST_LITERAL:
         return literal_type(node->value);
 
-    // case AST_IDENTIFIER: {
-    //     SymbolRef t = lookup_symbol(node->value);
-    //     if (t.scope == -1) {
-    //         printf("Semantic Error: '%s' not declared\n", node->value);
-    //         exit(1);
-    //     }
-    //     return scopes[t.scope].symbols[t.index].type;
-    // }
+    case AST_IDENTIFIER:
+        return symbols[resolve(node)].type;
 
     case AST_BINARY_OP: {
         SemType l = analyze_expr(node->left);
         SemType r = analyze_expr(node->right);
 
-        if (strcmp(node->value, "+") == 0) {
+        if (node->value == ATOM_PLUS) {
             if (l == TYPE_STRING || r == TYPE_STRING)
                 return TYPE_STRING;
             if (l == TYPE_NUMBER && r == TYPE_NUMBER)
@@ -142,7 +184,7 @@ static SemType analyze_expr(ASTNode *node) {
 
         if (l != TYPE_NUMBER || r != TYPE_NUMBER) {
             printf("Type Error: operator '%s' not valid for %s and %s\n",
-                   node->value, type_to_string(l), type_to_string(r));
+                   atom_str(node->value), type_to_string(l), type_to_string(r));
             exit(1);
         }
         return TYPE_NUMBER;
@@ -157,30 +199,26 @@ static SemType analyze_expr(ASTNode *node) {
 
 /* ---------- Semantic Walker ---------- */
 
-static void analyze_node(ASTNode *node) {
-    if (!node) return;
+static void analyze_node(NodeId id) {
+    if (!id) return;
+    ASTNode *node = ast_node(ast, id);
 
     switch (node->type) {
 
     case AST_POST_UPDATE:
     case AST_PRE_UPDATE: {
-        char var[64];
-        extract_update_identifier(var, node->value);
+        ASTNode *target = ast_node(ast, node->left);
+        Atom var = target->value;
+        SymbolId ref = resolve(target);
 
-        SymbolRef ref = lookup_symbol(var);
-        if (ref.scope == -1) {
-            printf("Semantic Error: '%s' not declared\n", var);
-            exit(1);
-        }
-
-        if (scopes[ref.scope].symbols[ref.index].type != TYPE_NUMBER) {
+        if (symbols[ref].type != TYPE_NUMBER) {
             printf("Type Error: update operator requires number, got %s\n",
-                type_to_string(scopes[ref.scope].symbols[ref.index].type));
+                type_to_string(symbols[ref].type));
             exit(1);
         }
 
-        if (scopes[ref.scope].symbols[ref.index].is_const) {
-            printf("Semantic Error: cannot modify const '%s'\n", var);
+        if (symbols[ref].is_const) {
+            printf("Semantic Error: cannot modify const '%s'\n", atom_str(var));
             exit(1);
         }
         break;
@@ -190,57 +228,64 @@ static void analyze_node(ASTNode *node) {
 
     case AST_BLOCK:
         enter_scope();
-        for (int i = 0; i < node->body_size; i++)
-            analyze_node(node->body[i]);
+        for (uint32_t i = 0; i < node->count; i++)
+            analyze_node(ast_kid(ast, node, i));
         exit_scope();
         break;
         
     case AST_ASSIGNMENT: {
+        ASTNode *lhs = ast_node(ast, node->left);
 
         // Declaration
-        if (node->left->type == AST_VAR_DECL) {
+        if (lhs->type == AST_VAR_DECL) {
             SemType rhs_type = analyze_expr(node->right);
-            declare_symbol(node->left->value, 0, rhs_type);
+            lhs->sym = declare_symbol(lhs->value, 0, rhs_type);
+            lhs->sem_type = rhs_type;
             return;
         }
 
         // Reassignment
-        if (node->left->type == AST_IDENTIFIER) {
-            SymbolRef idx = lookup_symbol(node->left->value);
-            if (idx.scope == -1) {
-                printf("Semantic Error: '%s' not declared\n", node->left->value);
-                exit(1);
-            }
+        if (lhs->type == AST_IDENTIFIER) {
+            SymbolId idx = resolve(lhs);
 
             SemType rhs_type = analyze_expr(node->right);
-            SemType lhs_type = scopes[idx.scope].symbols[idx.index].type;
+            SemType lhs_type = symbols[idx].type;
 
             
                 if (lhs_type == TYPE_UNKNOWN) {
-                    scopes[idx.scope].symbols[idx.index].type = rhs_type;
+                    symbols[idx].type = rhs_type;
                 }
                 else if (lhs_type != rhs_type) {
                     printf("Type Error: cannot assign %s to %s\n",
                     type_to_string(rhs_type), type_to_string(lhs_type));
                     exit(1);
                 }
+                lhs->sem_type = symbols[idx].type;
             }
         break;
     }
 
     case AST_IDENTIFIER:
-        if (lookup_symbol(node->value).scope == -1) {
-            printf("Semantic Error: '%s' is not declared\n", node->value);
-            exit(1);
-        }
+        resolve(node);
+        break;
+
+    case AST_FUNC_CALL:
+        for (uint32_t i = 0; i < node->count; i++)
+            analyze_expr(ast_kid(ast, node, i));
+        break;
+
+    case AST_IF_STMT:
+    case AST_WHILE_STMT:
+        analyze_expr(node->left); // condition
+        analyze_node(node->right);
         break;
 
     case AST_FOR_STMT:
         enter_scope();
         analyze_node(node->left); // init
-        analyze_node(node->right->body[0]); // condition
-        analyze_node(node->right->body[2]); // body
-        analyze_node(node->right->body[1]); // update
+        analyze_expr(ast_kid(ast, node, 0)); // condition
+        analyze_node(ast_kid(ast, node, 2)); // body
+        analyze_node(ast_kid(ast, node, 1)); // update
         exit_scope();
         break;
 
@@ -253,19 +298,18 @@ static void analyze_node(ASTNode *node) {
 
 /* ---------- Public Entry ---------- */
 
-void semantic_analyze(ASTNode *root) {
+void semantic_analyze(Ast *tree) {
+    ast = tree;
+    ensure_binding(atom_count());
     enter_scope();
-    analyze_node(root);
+    analyze_node(tree->root);
     exit_scope();
 }
 
-SemType semantic_get_type(const char *name) {
-    for (int i = max_scope_depth; i >= 0; i--) {
-        for (int j = 0; j < scopes[i].count; j++) {
-            if (strcmp(scopes[i].symbols[j].name, name) == 0)
-                return scopes[i].symbols[j].type;
-        }
-    }
-    return TYPE_NUMBER;
+const SemanticSymbol *semantic_symbol(SymbolId id) {
+    return id && id < symbol_count ? &symbols[id] : NULL;
 }
 
+uint32_t semantic_symbol_count(void) {
+    return symbol_count;
+}
@@ -0,0 +1,580 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/ssa.h"
+
+// Scratch buffer for rewriting the instruction stream
+typedef struct {
+    IRInstr *instrs;
+    int count;
+    int capacity;
+} IRBuffer;
+
+// (block, var) pairs, grouped into per-key ranges with group_pairs
+typedef struct {
+    int key;
+    int value;
+} Pair;
+
+typedef struct {
+    Pair *items;
+    int count;
+    int capacity;
+} PairList;
+
+static void *xcalloc(size_t count, size_t size)
+{
+    void *p = calloc(count ? count : 1, size);
+    if (!p)
+    {
+        perror("calloc");
+        exit(1);
+    }
+    return p;
+}
+
+static void buffer_push(IRBuffer *buf, IRInstr in)
+{
+    if (buf->count >= buf->capacity)
+    {
+        buf->capacity = buf->capacity ? buf->capacity * 2 : 1024;
+        buf->instrs = realloc(buf->instrs, sizeof(IRInstr) * buf->capacity);
+        if (!buf->instrs)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    buf->instrs[buf->count++] = in;
+}
+
+static void pair_push(PairList *list, int key, int value)
+{
+    if (list->count >= list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->items = realloc(list->items, sizeof(Pair) * list->capacity);
+        if (!list->items)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    list->items[list->count++] = (Pair){key, value};
+}
+
+// Counting sort by key: values of key k end up in out[first[k] .. first[k + 1])
+static int *group_pairs(const PairList *list, int keys, int **first_out)
+{
+    int *first = xcalloc(keys + 1, sizeof(int));
+    int *out = xcalloc(list->count, sizeof(int));
+    for (int i = 0; i < list->count; i++)
+        first[list->items[i].key + 1]++;
+    for (int k = 0; k < keys; k++)
+        first[k + 1] += first[k];
+
+    int *fill = xcalloc(keys, sizeof(int));
+    for (int i = 0; i < list->count; i++)
+    {
+        int k = list->items[i].key;
+        out[first[k] + fill[k]++] = list->items[i].value;
+    }
+    free(fill);
+    *first_out = first;
+    return out;
+}
+
+int ssa_promotable(SymbolId var)
+{
+    return var && semantic_symbol(var)->type != TYPE_STRING;
+}
+
+static int is_promoted_var(IROperand v)
+{
+    return v.kind == OPD_VAR && ssa_promotable(v.index);
+}
+
+// Position of pred in block's predecessor list (= its phi argument slot)
+static int pred_index(const BasicBlock *block, int pred)
+{
+    const int *preds = cfg_preds(block);
+    for (int i = 0; i < block->pred_count; i++)
+        if (preds[i] == pred)
+            return i;
+    return -1;
+}
+
+/* ---------- Dominance frontiers ---------- */
+
+static int *df_first;
+static int *df_blocks;
+
+static void compute_frontiers(int block_count)
+{
+    PairList pairs = {0};
+    int *stamp = xcalloc(block_count, sizeof(int));
+
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *join = cfg_get_block(b);
+        if (join->pred_count < 2 || join->rpo < 0)
+            continue;
+
+        const int *preds = cfg_preds(join);
+        for (int i = 0; i < join->pred_count; i++)
+        {
+            int runner = preds[i];
+            if (cfg_get_block(runner)->rpo < 0)
+                continue;
+            while (runner != join->idom)
+            {
+                if (stamp[runner] != b + 1)
+                {
+                    stamp[runner] = b + 1;
+                    pair_push(&pairs, runner, b);
+                }
+                runner = cfg_get_block(runner)->idom;
+            }
+        }
+    }
+
+    df_blocks = group_pairs(&pairs, block_count, &df_first);
+    free(pairs.items);
+    free(stamp);
+}
+
+/* ---------- Phi insertion ---------- */
+
+// Semi-pruned SSA: only variables read in some block before being
+// written there ("global" names) can need a phi
+static PairList find_defs(IRInstr *ir, int block_count, int var_count, char *global)
+{
+    PairList defs = {0};
+    int *killed = xcalloc(var_count, sizeof(int));
+    int *last_def = xcalloc(var_count, sizeof(int));
+
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        if (block->rpo < 0)
+            continue;
+
+        for (int i = block->first; i < block->end; i++)
+        {
+            IROperand *uses[2];
+            int n = ir_uses(&ir[i], uses);
+            for (int u = 0; u < n; u++)
+            {
+                if (is_promoted_var(*uses[u]) && killed[uses[u]->index] != b + 1)
+                    global[uses[u]->index] = 1;
+            }
+
+            IROperand *def = ir_def(&ir[i]);
+            if (def && is_promoted_var(*def))
+            {
+                killed[def->index] = b + 1;
+                if (last_def[def->index] != b + 1)
+                {
+                    last_def[def->index] = b + 1;
+                    pair_push(&defs, def->index, b);
+                }
+            }
+        }
+    }
+
+    free(killed);
+    free(last_def);
+    return defs;
+}
+
+static PairList place_phis(IRInstr *ir, int block_count)
+{
+    int var_count = semantic_symbol_count();
+    char *global = xcalloc(var_count, 1);
+    PairList defs = find_defs(ir, block_count, var_count, global);
+
+    int *def_first;
+    int *def_blocks = group_pairs(&defs, var_count, &def_first);
+
+    PairList phis = {0}; // (block, var)
+    int *has_phi = xcalloc(block_count, sizeof(int));
+    int *queued = xcalloc(block_count, sizeof(int));
+    int *work = xcalloc(block_count, sizeof(int));
+
+    for (int v = 1; v < var_count; v++)
+    {
+        if (!global[v])
+            continue;
+
+        int top = 0;
+        for (int i = def_first[v]; i < def_first[v + 1]; i++)
+        {
+            work[top++] = def_blocks[i];
+            queued[def_blocks[i]] = v;
+        }
+
+        while (top)
+        {
+            int x = work[--top];
+            for (int i = df_first[x]; i < df_first[x + 1]; i++)
+            {
+                int y = df_blocks[i];
+                if (has_phi[y] == v)
+                    continue;
+                has_phi[y] = v;
+                pair_push(&phis, y, v);
+                if (queued[y] != v)
+                {
+                    queued[y] = v;
+                    work[top++] = y;
+                }
+            }
+        }
+    }
+
+    free(global);
+    free(defs.items);
+    free(def_first);
+    free(def_blocks);
+    free(has_phi);
+    free(queued);
+    free(work);
+    return phis;
+}
+
+// Copy the IR with each block's phis placed right after its label
+static void insert_phis(IRInstr *ir, int ir_count, int block_count, const PairList *phis)
+{
+    int *phi_first;
+    int *phi_vars = group_pairs(phis, block_count, &phi_first);
+
+    IRBuffer buf = {0};
+    buf.capacity = ir_count + phis->count;
+    buf.instrs = malloc(sizeof(IRInstr) * buf.capacity);
+
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        int i = block->first;
+        if (i < block->end && ir[i].op == IR_LABEL)
+            buffer_push(&buf, ir[i++]);
+
+        for (int p = phi_first[b]; p < phi_first[b + 1]; p++)
+        {
+            IRInstr phi = ir_new_phi(phi_vars[p], block->pred_count);
+            phi.dst = ir_new_temp();
+            buffer_push(&buf, phi);
+        }
+
+        for (; i < block->end; i++)
+            buffer_push(&buf, ir[i]);
+    }
+
+    free(phi_first);
+    free(phi_vars);
+    ir_replace(buf.instrs, buf.count, buf.capacity);
+}
+
+/* ---------- Renaming ---------- */
+
+// Current SSA value of each variable, with an undo log so leaving a
+// dominator subtree restores the values of its parent
+typedef struct {
+    SymbolId var;
+    IROperand prev;
+} RenameUndo;
+
+static IROperand *current;
+static RenameUndo *undo;
+static int undo_count = 0;
+static int undo_capacity = 0;
+
+static void push_def(SymbolId var, IROperand value)
+{
+    if (undo_count >= undo_capacity)
+    {
+        undo_capacity = undo_capacity ? undo_capacity * 2 : 256;
+        undo = realloc(undo, sizeof(RenameUndo) * undo_capacity);
+        if (!undo)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    undo[undo_count++] = (RenameUndo){var, current[var]};
+    current[var] = value;
+}
+
+static void pop_defs(int mark)
+{
+    while (undo_count > mark)
+    {
+        undo_count--;
+        current[undo[undo_count].var] = undo[undo_count].prev;
+    }
+}
+
+// Reads of a variable no definition reaches see 0
+static IROperand current_value(SymbolId var)
+{
+    if (current[var].kind == OPD_NONE)
+        return (IROperand){.kind = OPD_INT, .imm = 0};
+    return current[var];
+}
+
+static void rename_block(IRInstr *ir, BasicBlock *block)
+{
+    for (int i = block->first; i < block->end; i++)
+    {
+        IRInstr *in = &ir[i];
+        if (in->op == IR_PHI)
+        {
+            push_def(in->rhs.index, in->dst);
+            continue;
+        }
+
+        IROperand *uses[2];
+        int n = ir_uses(in, uses);
+        for (int u = 0; u < n; u++)
+        {
+            if (is_promoted_var(*uses[u]))
+                *uses[u] = current_value(uses[u]->index);
+        }
+
+        if (in->op == IR_ASSIGN && is_promoted_var(in->dst))
+        {
+            SymbolId var = in->dst.index;
+            in->dst = ir_new_temp();
+            push_def(var, in->dst);
+        }
+    }
+
+    // Fill this block's slot in the phis of each successor
+    const int *succs = cfg_succs(block);
+    for (int s = 0; s < block->succ_count; s++)
+    {
+        BasicBlock *succ = cfg_get_block(succs[s]);
+        int slot = pred_index(succ, block->id);
+        for (int i = succ->first; i < succ->end; i++)
+        {
+            if (ir[i].op == IR_LABEL)
+                continue;
+            if (ir[i].op != IR_PHI)
+                break;
+            ir_phi_args(&ir[i])[slot] = current_value(ir[i].rhs.index);
+        }
+    }
+}
+
+// Preorder walk of the dominator tree with an explicit stack
+static void rename_all(IRInstr *ir, int block_count)
+{
+    current = xcalloc(semantic_symbol_count(), sizeof(IROperand));
+    int *stack = xcalloc(block_count, sizeof(int));
+    int *next = xcalloc(block_count, sizeof(int));
+    int *mark = xcalloc(block_count, sizeof(int));
+    int top = 0;
+
+    stack[top++] = 0;
+    mark[0] = undo_count;
+    rename_block(ir, cfg_get_block(0));
+
+    while (top)
+    {
+        BasicBlock *block = cfg_get_block(stack[top - 1]);
+        if (next[block->id] < block->dom_count)
+        {
+            int kid = cfg_dom_children(block)[next[block->id]++];
+            mark[kid] = undo_count;
+            rename_block(ir, cfg_get_block(kid));
+            stack[top++] = kid;
+            continue;
+        }
+        pop_defs(mark[block->id]);
+        top--;
+    }
+
+    free(current);
+    free(stack);
+    free(next);
+    free(mark);
+}
+
+void ssa_construct(void)
+{
+    int ir_count;
+    IRInstr *ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+
+    compute_frontiers(block_count);
+    PairList phis = place_phis(ir, block_count);
+    insert_phis(ir, ir_count, block_count, &phis);
+    free(phis.items);
+    free(df_first);
+    free(df_blocks);
+
+    // Phis sit inside existing blocks, so the block structure is unchanged
+    ir = ir_get_all(&ir_count);
+    cfg_build(ir, ir_count);
+    rename_all(ir, block_count);
+}
+
+/* ---------- Destruction ---------- */
+
+static int block_has_phis(IRInstr *ir, const BasicBlock *block)
+{
+    for (int i = block->first; i < block->end; i++)
+    {
+        if (ir[i].op == IR_PHI)
+            return 1;
+        if (ir[i].op != IR_LABEL && ir[i].op != IR_NOP)
+            return 0;
+    }
+    return 0;
+}
+
+// The copies for edge pred -> succ form a parallel assignment; when one
+// copy reads another's destination, go through fresh temporaries
+static void emit_edge_copies(IRBuffer *buf, IRInstr *ir, int pred, const BasicBlock *succ)
+{
+    int slot = pred_index(succ, pred);
+    int first = succ->first;
+    while (first < succ->end && ir[first].op == IR_LABEL)
+        first++;
+    // DCE leaves dead phis as NOPs, so the phi run may contain holes
+    int last = first;
+    while (last < succ->end && (ir[last].op == IR_PHI || ir[last].op == IR_NOP))
+        last++;
+
+    int overlap = 0;
+    for (int i = first; i < last && !overlap; i++)
+    {
+        if (ir[i].op != IR_PHI)
+            continue;
+        IROperand src = ir_phi_args(&ir[i])[slot];
+        for (int j = first; j < last; j++)
+        {
+            if (j != i && ir[j].op == IR_PHI && src.kind == OPD_TEMP && ir[j].dst.kind == OPD_TEMP &&
+                src.index == ir[j].dst.index)
+                overlap = 1;
+        }
+    }
+
+    if (!overlap)
+    {
+        for (int i = first; i < last; i++)
+        {
+            if (ir[i].op == IR_PHI)
+                buffer_push(buf, (IRInstr){.op = IR_ASSIGN, .dst = ir[i].dst, .lhs = ir_phi_args(&ir[i])[slot]});
+        }
+        return;
+    }
+
+    IROperand *tmp = xcalloc(last - first, sizeof(IROperand));
+    for (int i = first; i < last; i++)
+    {
+        if (ir[i].op != IR_PHI)
+            continue;
+        tmp[i - first] = ir_new_temp();
+        buffer_push(buf, (IRInstr){.op = IR_ASSIGN, .dst = tmp[i - first], .lhs = ir_phi_args(&ir[i])[slot]});
+    }
+    for (int i = first; i < last; i++)
+    {
+        if (ir[i].op == IR_PHI)
+            buffer_push(buf, (IRInstr){.op = IR_ASSIGN, .dst = ir[i].dst, .lhs = tmp[i - first]});
+    }
+    free(tmp);
+}
+
+// A critical jump edge gets a new block at the end of the stream
+typedef struct {
+    IROperand label;  // new block
+    IROperand target; // original jump target
+    int pred;
+    int succ;
+} SplitEdge;
+
+void ssa_destruct(void)
+{
+    int ir_count;
+    IRInstr *ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+
+    IRBuffer buf = {0};
+    SplitEdge *splits = xcalloc(block_count, sizeof(SplitEdge));
+    int split_count = 0;
+
+    for (int b = 0; b < block_count; b++)
+    {
+        BasicBlock *block = cfg_get_block(b);
+        const int *succs = cfg_succs(block);
+        int end = block->end;
+        IRInstr *term = NULL;
+        if (end > block->first &&
+            (ir[end - 1].op == IR_GOTO || ir[end - 1].op == IR_IF_FALSE || ir[end - 1].op == IR_RET))
+            term = &ir[--end];
+
+        for (int i = block->first; i < end; i++)
+        {
+            if (ir[i].op != IR_PHI)
+                buffer_push(&buf, ir[i]);
+        }
+
+        if (block->rpo < 0)
+        {
+            if (term)
+                buffer_push(&buf, *term);
+            continue;
+        }
+
+        if (block->succ_count == 1)
+        {
+            BasicBlock *succ = cfg_get_block(succs[0]);
+            if (block_has_phis(ir, succ))
+                emit_edge_copies(&buf, ir, b, succ);
+            // A conditional jump with one edge (a constant condition, or
+            // both edges meeting) is a goto or a fallthrough
+            if (term && term->op == IR_IF_FALSE)
+            {
+                if (succ->id != b + 1)
+                    buffer_push(&buf, (IRInstr){.op = IR_GOTO, .dst = term->dst});
+            }
+            else if (term)
+                buffer_push(&buf, *term);
+            continue;
+        }
+
+        if (block->succ_count == 2)
+        {
+            BasicBlock *fall = cfg_get_block(succs[0]);
+            BasicBlock *target = cfg_get_block(succs[1]);
+            IRInstr jump = *term;
+
+            if (block_has_phis(ir, target))
+            {
+                jump.dst = ir_new_label();
+                splits[split_count++] = (SplitEdge){jump.dst, term->dst, b, target->id};
+            }
+            buffer_push(&buf, jump);
+
+            // Code right after the jump runs only on the fallthrough edge
+            if (block_has_phis(ir, fall))
+                emit_edge_copies(&buf, ir, b, fall);
+            continue;
+        }
+
+        if (term)
+            buffer_push(&buf, *term);
+    }
+
+    for (int i = 0; i < split_count; i++)
+    {
+        buffer_push(&buf, (IRInstr){.op = IR_LABEL, .dst = splits[i].label});
+        emit_edge_copies(&buf, ir, splits[i].pred, cfg_get_block(splits[i].succ));
+        buffer_push(&buf, (IRInstr){.op = IR_GOTO, .dst = splits[i].target});
+    }
+    free(splits);
+
+    ir_replace(buf.instrs, buf.count, buf.capacity);
+    cfg_build(buf.instrs, buf.count);
+}
@@ -0,0 +1,342 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "../../include/stats.h"
+
+/* ---------- Allocation counters ---------- */
+
+// The link maps malloc/calloc/realloc here (-Wl,--wrap=...), so every
+// allocation made by the compiler's own code is counted. The lexer
+// thread allocates too, hence the atomics.
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+static unsigned long alloc_count = 0;
+static unsigned long alloc_bytes = 0;
+
+static void count_alloc(size_t bytes)
+{
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&alloc_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    count_alloc(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    count_alloc(count * size);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    count_alloc(size);
+    return __real_realloc(p, size);
+}
+
+/* ---------- Phases ---------- */
+
+#define MAX_DEPTH 16
+
+typedef struct {
+    const char *name;
+    int depth;
+    int external;
+    long start_ns;
+    long end_ns;
+    unsigned long allocs;
+    unsigned long bytes;
+    long rss_kb; // peak RSS of the compiler, or of the tool for external phases
+} Phase;
+
+static int enabled = 0;
+static long origin_ns = 0;
+static Phase *phases;
+static int phase_count = 0;
+static int phase_capacity = 0;
+static int open_phases[MAX_DEPTH];
+static int depth = 0;
+
+static long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void stats_enable(void)
+{
+    enabled = 1;
+    origin_ns = now_ns();
+}
+
+static Phase *new_phase(const char *name)
+{
+    if (phase_count >= phase_capacity)
+    {
+        phase_capacity = phase_capacity ? phase_capacity * 2 : 32;
+        phases = realloc(phases, sizeof(Phase) * phase_capacity);
+        if (!phases)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    Phase *p = &phases[phase_count++];
+    *p = (Phase){.name = name, .depth = depth};
+    return p;
+}
+
+void stats_begin(const char *name)
+{
+    if (!enabled)
+        return;
+    if (depth >= MAX_DEPTH)
+    {
+        printf("Error: phases nested deeper than %d\n", MAX_DEPTH);
+        exit(1);
+    }
+
+    Phase *p = new_phase(name);
+    open_phases[depth++] = phase_count - 1;
+    p->allocs = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    p->bytes = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+    p->start_ns = now_ns();
+}
+
+void stats_end(void)
+{
+    if (!enabled || depth == 0)
+        return;
+
+    Phase *p = &phases[open_phases[--depth]];
+    p->end_ns = now_ns();
+    p->allocs = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED) - p->allocs;
+    p->bytes = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED) - p->bytes;
+    p->rss_kb = peak_rss_kb();
+}
+
+// Feed in to the child's stdin while collecting its stdout, without
+// deadlocking when both pipes fill up
+static int pump(int in_fd, const char *in, size_t in_len, int out_fd, char **out, size_t *out_len)
+{
+    size_t written = 0, capacity = 0;
+    *out = NULL;
+    *out_len = 0;
+    if (in_fd >= 0)
+        fcntl(in_fd, F_SETFL, O_NONBLOCK);
+
+    while (in_fd >= 0 || out_fd >= 0)
+    {
+        struct pollfd fds[2];
+        int n = 0, in_slot = -1, out_slot = -1;
+        if (in_fd >= 0)
+        {
+            in_slot = n;
+            fds[n++] = (struct pollfd){.fd = in_fd, .events = POLLOUT};
+        }
+        if (out_fd >= 0)
+        {
+            out_slot = n;
+            fds[n++] = (struct pollfd){.fd = out_fd, .events = POLLIN};
+        }
+        if (poll(fds, n, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return -1;
+        }
+
+        if (in_slot >= 0 && fds[in_slot].revents)
+        {
+            ssize_t k = in_len > written ? write(in_fd, in + written, in_len - written) : 0;
+            if (k > 0)
+                written += k;
+            if (written == in_len || (k < 0 && errno != EAGAIN))
+            {
+                close(in_fd);
+                in_fd = -1;
+            }
+        }
+
+        if (out_slot >= 0 && fds[out_slot].revents)
+        {
+            if (capacity - *out_len < 4096)
+            {
+                capacity = capacity ? capacity * 2 : 65536;
+                *out = realloc(*out, capacity);
+                if (!*out)
+                {
+                    perror("realloc");
+                    exit(1);
+                }
+            }
+            ssize_t k = read(out_fd, *out + *out_len, capacity - *out_len);
+            if (k > 0)
+                *out_len += k;
+            else if (k == 0 || errno != EINTR)
+            {
+                close(out_fd);
+                out_fd = -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int stats_exec_io(const char *name, char *const argv[], const char *in, size_t in_len,
+                  char **out, size_t *out_len)
+{
+    long start = now_ns();
+    int to_child[2] = {-1, -1}, from_child[2] = {-1, -1};
+    if ((in && pipe(to_child) < 0) || (out && pipe(from_child) < 0))
+    {
+        perror("pipe");
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN); // a tool that exits early must not kill us
+    fflush(NULL);             // the child must not inherit buffered output
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0)
+    {
+        if (in)
+        {
+            dup2(to_child[0], STDIN_FILENO);
+            close(to_child[0]);
+            close(to_child[1]);
+        }
+        if (out)
+        {
+            dup2(from_child[1], STDOUT_FILENO);
+            close(from_child[0]);
+            close(from_child[1]);
+        }
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+
+    if (in)
+        close(to_child[0]);
+    if (out)
+        close(from_child[1]);
+    if (in || out)
+    {
+        char *ignored;
+        size_t ignored_len;
+        pump(to_child[1], in, in_len, from_child[0],
+             out ? out : &ignored, out ? out_len : &ignored_len);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        perror("wait4");
+        return -1;
+    }
+
+    if (enabled)
+    {
+        Phase *p = new_phase(name);
+        p->external = 1;
+        p->start_ns = start;
+        p->end_ns = now_ns();
+        p->rss_kb = usage.ru_maxrss;
+    }
+    if (WIFSIGNALED(status))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], strsignal(WTERMSIG(status)));
+        return 128 + WTERMSIG(status); // as the shell reports it
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int stats_exec(const char *name, char *const argv[])
+{
+    return stats_exec_io(name, argv, NULL, 0, NULL, NULL);
+}
+
+/* ---------- Output ---------- */
+
+void stats_report(FILE *out)
+{
+    if (!enabled)
+        return;
+
+    fprintf(out, "\n=== Compile statistics ===\n");
+    fprintf(out, "%-22s %10s %10s %12s %12s\n", "phase", "ms", "allocs", "alloc KB", "peak RSS KB");
+    for (int i = 0; i < phase_count; i++)
+    {
+        const Phase *p = &phases[i];
+        char label[64];
+        snprintf(label, sizeof(label), "%*s%s%s", p->depth * 2, "", p->name,
+                 p->external ? " (ext)" : "");
+        fprintf(out, "%-22s %10.3f ", label, (p->end_ns - p->start_ns) / 1e6);
+        if (p->external)
+            fprintf(out, "%10s %12s", "-", "-");
+        else
+            fprintf(out, "%10lu %12.1f", p->allocs, p->bytes / 1024.0);
+        fprintf(out, " %12ld\n", p->rss_kb);
+    }
+}
+
+int stats_write_trace(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+
+    // Complete ("X") events in microseconds; external tools on their own row
+    fprintf(f, "{\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"jscc\"}},\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"compiler\"}},\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"external tools\"}}");
+    for (int i = 0; i < phase_count; i++)
+    {
+        const Phase *p = &phases[i];
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                   "\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                p->name, p->external ? "tool" : "compile", p->external ? 2 : 1,
+                (p->start_ns - origin_ns) / 1e3, (p->end_ns - p->start_ns) / 1e3);
+        if (!p->external)
+            fprintf(f, "\"allocs\":%lu,\"alloc_bytes\":%lu,", p->allocs, p->bytes);
+        fprintf(f, "\"peak_rss_kb\":%ld}}", p->rss_kb);
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return 0;
+}
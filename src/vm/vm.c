@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vm.h"
+#include "semantic.h"
+
+// Lowering is one walk over the instruction stream, which is valid
+// straight-line code once phis are gone. Jumps hold label numbers until
+// every label has a pc. Dispatch uses GNU C labels as values.
+
+static IRInstr *ir;
+static VMProgram *out;
+static int capacity, slot_capacity;
+static int temp_base, var_base;
+static int *use_count; // per temporary
+
+/* ---------- Lowering ---------- */
+
+static void emit(VMOp op, uint32_t a, uint32_t b, uint32_t c)
+{
+    if (out->count == capacity)
+    {
+        capacity = capacity ? capacity * 2 : 256;
+        out->code = realloc(out->code, sizeof(VMInstr) * capacity);
+    }
+    out->code[out->count++] = (VMInstr){op, a, b, c};
+}
+
+static int is_imm(IROperand v)
+{
+    return v.kind == OPD_INT || v.kind == OPD_CONST;
+}
+
+static int32_t imm_value(IROperand v)
+{
+    if (v.kind == OPD_INT)
+        return v.imm;
+    // Strings have no value yet and read as 0, as on the QBE path
+    if (v.kind == OPD_STR)
+        return 0;
+    // Every value is a word, so wide and fractional constants truncate
+    const IRConst *c = ir_const(v.index);
+    return (int32_t)(c->is_double ? (int64_t)c->d : c->i);
+}
+
+// Strings have no representation yet, as on the native paths
+static int has_value(IROperand v)
+{
+    if (v.kind == OPD_VAR)
+        return v.index && semantic_symbol(v.index)->type != TYPE_STRING;
+    return v.kind == OPD_TEMP || is_imm(v);
+}
+
+static uint32_t slot_of(IROperand v)
+{
+    if (v.kind == OPD_TEMP)
+        return temp_base + v.index;
+    if (v.kind == OPD_VAR)
+        return var_base + v.index;
+
+    if (out->slot_count == slot_capacity)
+    {
+        slot_capacity *= 2;
+        out->slots = realloc(out->slots, sizeof(int32_t) * slot_capacity);
+    }
+    out->slots[out->slot_count] = imm_value(v);
+    return out->slot_count++;
+}
+
+// The compare right before a branch, when the branch is its only use
+static int fusable_compare(int i, int branch)
+{
+    const IRInstr *cmp = &ir[i];
+    const IRInstr *jump = &ir[branch];
+    return cmp->op >= IR_EQ && cmp->op <= IR_GE && jump->lhs.kind == OPD_TEMP &&
+           cmp->dst.index == jump->lhs.index && use_count[jump->lhs.index] == 1;
+}
+
+static const VMOp inverse_jump[] = {
+    [IR_EQ] = VM_JNE, [IR_NE] = VM_JEQ, [IR_LT] = VM_JGE,
+    [IR_GE] = VM_JLT, [IR_LE] = VM_JGT, [IR_GT] = VM_JLE,
+};
+
+// Index of the next instruction that is not a NOP
+static int next_live(int i, int count)
+{
+    while (i < count && ir[i].op == IR_NOP)
+        i++;
+    return i;
+}
+
+void vm_compile(VMProgram *prog)
+{
+    int ir_count;
+    ir = ir_get_all(&ir_count);
+    out = prog;
+    memset(prog, 0, sizeof(*prog));
+    capacity = 0;
+
+    temp_base = 0;
+    var_base = ir_temp_count() + 1;
+    prog->slot_count = var_base + semantic_symbol_count() + 1;
+    slot_capacity = prog->slot_count + 64;
+    prog->slots = calloc(slot_capacity, sizeof(int32_t));
+
+    use_count = calloc(ir_temp_count() + 1, sizeof(int));
+    for (int i = 0; i < ir_count; i++)
+    {
+        IROperand *ops[3];
+        int n = ir_uses(&ir[i], ops);
+        for (int u = 0; u < n; u++)
+            if (ops[u]->kind == OPD_TEMP)
+                use_count[ops[u]->index]++;
+    }
+
+    int label_count = ir_label_count();
+    int *label_pc = malloc(sizeof(int) * (label_count + 1));
+
+    for (int i = 0; i < ir_count; i++)
+    {
+        IRInstr *in = &ir[i];
+        switch (in->op)
+        {
+        case IR_ASSIGN:
+            if (has_value(in->dst) && has_value(in->lhs))
+                emit(VM_MOV, slot_of(in->dst), slot_of(in->lhs), 0);
+            break;
+        case IR_LABEL:
+            label_pc[in->dst.index] = prog->count;
+            break;
+        case IR_GOTO:
+            emit(VM_JMP, in->dst.index, 0, 0);
+            break;
+        case IR_IF_FALSE:
+            if (is_imm(in->lhs))
+            {
+                if (imm_value(in->lhs) == 0)
+                    emit(VM_JMP, in->dst.index, 0, 0);
+            }
+            else
+                emit(VM_JZ, in->dst.index, slot_of(in->lhs), 0);
+            break;
+        case IR_CALL:
+            if (in->callee == CALLEE_CONSOLE_LOG && i > 0 && has_value(ir[i - 1].lhs))
+                emit(VM_PRINT, slot_of(ir[i - 1].lhs), 0, 0);
+            break;
+        case IR_RET:
+            emit(VM_RET, 0, 0, 0);
+            break;
+        default:
+            if (IR_IS_BINARY(in->op))
+            {
+                int branch = next_live(i + 1, ir_count);
+                if (branch < ir_count && ir[branch].op == IR_IF_FALSE && fusable_compare(i, branch))
+                {
+                    emit(inverse_jump[in->op], ir[branch].dst.index, slot_of(in->lhs), slot_of(in->rhs));
+                    i = branch;
+                }
+                else
+                    emit(VM_ADD + (in->op - IR_ADD), slot_of(in->dst), slot_of(in->lhs), slot_of(in->rhs));
+            }
+            // Params, nops: the call picks up its argument itself
+            break;
+        }
+    }
+    emit(VM_RET, 0, 0, 0);
+
+    for (int pc = 0; pc < prog->count; pc++)
+        if (prog->code[pc].op >= VM_JMP && prog->code[pc].op <= VM_JGE)
+            prog->code[pc].a = label_pc[prog->code[pc].a];
+
+    free(label_pc);
+    free(use_count);
+}
+
+void vm_free(VMProgram *prog)
+{
+    free(prog->code);
+    free(prog->slots);
+    memset(prog, 0, sizeof(*prog));
+}
+
+/* ---------- Printing ---------- */
+
+static const char *const vm_names[VM_OP_COUNT] = {
+    "mov", "add", "sub", "mul", "div", "eq", "ne", "lt", "gt", "le", "ge",
+    "jmp", "jz", "jeq", "jne", "jlt", "jgt", "jle", "jge", "print", "ret",
+};
+
+void vm_print(const VMProgram *prog)
+{
+    for (int pc = 0; pc < prog->count; pc++)
+    {
+        const VMInstr *in = &prog->code[pc];
+        printf("%4d  %-6s", pc, vm_names[in->op]);
+        if (in->op == VM_MOV)
+            printf("r%u, r%u", in->a, in->b);
+        else if (in->op <= VM_GE)
+            printf("r%u, r%u, r%u", in->a, in->b, in->c);
+        else if (in->op == VM_JMP)
+            printf("%u", in->a);
+        else if (in->op == VM_JZ)
+            printf("r%u, %u", in->b, in->a);
+        else if (in->op <= VM_JGE)
+            printf("r%u, r%u, %u", in->b, in->c, in->a);
+        else if (in->op == VM_PRINT)
+            printf("r%u", in->a);
+        printf("\n");
+    }
+}
+
+/* ---------- Interpreter ---------- */
+
+static void print_int(int32_t value)
+{
+    char buf[16];
+    char *p = buf + sizeof(buf);
+    *--p = '\n';
+    uint32_t u = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    do
+        *--p = '0' + u % 10;
+    while (u /= 10);
+    if (value < 0)
+        *--p = '-';
+    fwrite(p, 1, buf + sizeof(buf) - p, stdout);
+}
+
+// Arithmetic wraps like the machine instructions do
+#define WRAP(x, op, y) ((int32_t)((uint32_t)(x) op (uint32_t)(y)))
+
+int vm_run(const VMProgram *prog)
+{
+    static void *const dispatch[VM_OP_COUNT] = {
+        &&op_mov, &&op_add, &&op_sub, &&op_mul, &&op_div,
+        &&op_eq, &&op_ne, &&op_lt, &&op_gt, &&op_le, &&op_ge,
+        &&op_jmp, &&op_jz, &&op_jeq, &&op_jne, &&op_jlt, &&op_jgt, &&op_jle, &&op_jge,
+        &&op_print, &&op_ret,
+    };
+
+    int32_t *r = malloc(sizeof(int32_t) * prog->slot_count);
+    memcpy(r, prog->slots, sizeof(int32_t) * prog->slot_count);
+    const VMInstr *code = prog->code;
+    const VMInstr *pc = code;
+    int status = 0;
+
+#define NEXT() goto *dispatch[(++pc)->op]
+#define JUMP_IF(cond) do { if (cond) { pc = code + pc->a; goto *dispatch[pc->op]; } NEXT(); } while (0)
+
+    goto *dispatch[pc->op];
+
+op_mov: r[pc->a] = r[pc->b]; NEXT();
+op_add: r[pc->a] = WRAP(r[pc->b], +, r[pc->c]); NEXT();
+op_sub: r[pc->a] = WRAP(r[pc->b], -, r[pc->c]); NEXT();
+op_mul: r[pc->a] = WRAP(r[pc->b], *, r[pc->c]); NEXT();
+op_div:
+    if (r[pc->c] == 0)
+    {
+        fflush(stdout);
+        fprintf(stderr, "Runtime error: division by zero\n");
+        status = 1;
+        goto op_ret;
+    }
+    // INT32_MIN / -1 wraps instead of trapping
+    r[pc->a] = r[pc->c] == -1 ? WRAP(0, -, r[pc->b]) : r[pc->b] / r[pc->c];
+    NEXT();
+op_eq: r[pc->a] = r[pc->b] == r[pc->c]; NEXT();
+op_ne: r[pc->a] = r[pc->b] != r[pc->c]; NEXT();
+op_lt: r[pc->a] = r[pc->b] < r[pc->c]; NEXT();
+op_gt: r[pc->a] = r[pc->b] > r[pc->c]; NEXT();
+op_le: r[pc->a] = r[pc->b] <= r[pc->c]; NEXT();
+op_ge: r[pc->a] = r[pc->b] >= r[pc->c]; NEXT();
+op_jmp: pc = code + pc->a; goto *dispatch[pc->op];
+op_jz: JUMP_IF(r[pc->b] == 0);
+op_jeq: JUMP_IF(r[pc->b] == r[pc->c]);
+op_jne: JUMP_IF(r[pc->b] != r[pc->c]);
+op_jlt: JUMP_IF(r[pc->b] < r[pc->c]);
+op_jgt: JUMP_IF(r[pc->b] > r[pc->c]);
+op_jle: JUMP_IF(r[pc->b] <= r[pc->c]);
+op_jge: JUMP_IF(r[pc->b] >= r[pc->c]);
+op_print: print_int(r[pc->a]); NEXT();
+op_ret:
+#undef NEXT
+#undef JUMP_IF
+    fflush(stdout);
+    free(r);
+    return status;
+}
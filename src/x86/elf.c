@@ -0,0 +1,73 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+#include "x86.h"
+
+// Static executable with two segments: headers plus code (R+X), and the
+// zero-filled data area (R+W). Code starts on its own page so the data
+// offset computed by x86_codegen holds for the loaded addresses too.
+
+#define BASE_ADDR 0x400000
+#define CODE_FILE_OFFSET 0x1000
+
+int x86_write_elf(const X86Image *image, const char *path)
+{
+    Elf64_Ehdr eh = {0};
+    memcpy(eh.e_ident, ELFMAG, SELFMAG);
+    eh.e_ident[EI_CLASS] = ELFCLASS64;
+    eh.e_ident[EI_DATA] = ELFDATA2LSB;
+    eh.e_ident[EI_VERSION] = EV_CURRENT;
+    eh.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    eh.e_type = ET_EXEC;
+    eh.e_machine = EM_X86_64;
+    eh.e_version = EV_CURRENT;
+    eh.e_entry = BASE_ADDR + CODE_FILE_OFFSET + image->start_offset;
+    eh.e_phoff = sizeof(Elf64_Ehdr);
+    eh.e_ehsize = sizeof(Elf64_Ehdr);
+    eh.e_phentsize = sizeof(Elf64_Phdr);
+    eh.e_phnum = 2;
+
+    Elf64_Phdr ph[2] = {0};
+    ph[0].p_type = PT_LOAD;
+    ph[0].p_flags = PF_R | PF_X;
+    ph[0].p_offset = 0;
+    ph[0].p_vaddr = ph[0].p_paddr = BASE_ADDR;
+    ph[0].p_filesz = ph[0].p_memsz = CODE_FILE_OFFSET + image->code_len;
+    ph[0].p_align = 0x1000;
+
+    ph[1].p_type = PT_LOAD;
+    ph[1].p_flags = PF_R | PF_W;
+    ph[1].p_offset = 0;
+    ph[1].p_vaddr = ph[1].p_paddr = BASE_ADDR + CODE_FILE_OFFSET + image->data_offset;
+    ph[1].p_filesz = 0;
+    ph[1].p_memsz = image->data_size;
+    ph[1].p_align = 0x1000;
+
+    // Replace rather than rewrite in place: the old binary may be running
+    unlink(path);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd < 0)
+    {
+        perror(path);
+        return -1;
+    }
+
+    static const uint8_t zeros[CODE_FILE_OFFSET];
+    size_t header = sizeof(eh) + sizeof(ph);
+    int ok = write(fd, &eh, sizeof(eh)) == (ssize_t)sizeof(eh) &&
+             write(fd, ph, sizeof(ph)) == (ssize_t)sizeof(ph) &&
+             write(fd, zeros, CODE_FILE_OFFSET - header) == (ssize_t)(CODE_FILE_OFFSET - header) &&
+             write(fd, image->code, image->code_len) == (ssize_t)image->code_len;
+    close(fd);
+    if (!ok)
+    {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "x86.h"
+
+// Byte buffer with labels. A fixup is a rel32 field patched once every
+// label is bound (branches, calls) or once the data area is placed
+// (RIP-relative data references).
+
+typedef struct X86Fixup {
+    size_t at;    // offset of the 4-byte field
+    size_t next;  // offset of the next instruction, the base for rel32
+    int label;    // target label, or -1 for a data reference
+    int32_t data; // data area offset when label < 0
+} X86Fixup;
+
+static void *grow(void *p, int *cap, int count, size_t size)
+{
+    if (count < *cap)
+        return p;
+    *cap = *cap ? *cap * 2 : 64;
+    p = realloc(p, size * *cap);
+    if (!p)
+    {
+        perror("realloc");
+        exit(1);
+    }
+    return p;
+}
+
+void x86_asm_init(X86Asm *a)
+{
+    memset(a, 0, sizeof(*a));
+}
+
+void x86_asm_free(X86Asm *a)
+{
+    free(a->buf);
+    free(a->labels);
+    free(a->fixups);
+    memset(a, 0, sizeof(*a));
+}
+
+void x86_byte(X86Asm *a, uint8_t b)
+{
+    if (a->len == a->cap)
+    {
+        a->cap = a->cap ? a->cap * 2 : 4096;
+        a->buf = realloc(a->buf, a->cap);
+        if (!a->buf)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    a->buf[a->len++] = b;
+}
+
+void x86_imm32(X86Asm *a, int32_t v)
+{
+    uint32_t u = (uint32_t)v;
+    for (int i = 0; i < 4; i++)
+        x86_byte(a, (uint8_t)(u >> (8 * i)));
+}
+
+static void add_fixup(X86Asm *a, int label, int32_t data, size_t next)
+{
+    a->fixups = grow(a->fixups, &a->fixup_cap, a->fixup_count, sizeof(X86Fixup));
+    a->fixups[a->fixup_count++] = (X86Fixup){a->len, next, label, data};
+    x86_imm32(a, 0);
+}
+
+void x86_modrm(X86Asm *a, int width, const char *opcode, int reg, X86Rm rm, int imm_size)
+{
+    int base = rm.kind == X86_RM_DATA ? 0 : rm.reg;
+    uint8_t rex = (width == 64 ? 0x08 : 0) | (reg >= 8 ? 0x04 : 0) |
+                  (rm.kind != X86_RM_DATA && base >= 8 ? 0x01 : 0);
+    // spl/bpl/sil/dil need an empty REX to be addressable as bytes
+    if (width == 8 && rm.kind == X86_RM_REG && base >= 4 && base < 8)
+        rex |= 0x40;
+    if (width == 8 && reg >= 4 && reg < 8)
+        rex |= 0x40;
+    if (rex)
+        x86_byte(a, 0x40 | rex);
+
+    size_t n = strlen(opcode);
+    for (size_t i = 0; i < n; i++)
+        x86_byte(a, (uint8_t)opcode[i]);
+
+    switch (rm.kind)
+    {
+    case X86_RM_REG:
+        x86_byte(a, 0xC0 | (reg & 7) << 3 | (base & 7));
+        break;
+    case X86_RM_MEM:
+        // Always disp32; rsp and r12 as a base need a SIB byte
+        x86_byte(a, 0x80 | (reg & 7) << 3 | (base & 7));
+        if ((base & 7) == RSP)
+            x86_byte(a, 0x24);
+        x86_imm32(a, rm.disp);
+        break;
+    case X86_RM_DATA:
+        x86_byte(a, (reg & 7) << 3 | 0x05);
+        add_fixup(a, -1, rm.disp, a->len + 4 + imm_size);
+        break;
+    }
+}
+
+int x86_new_label(X86Asm *a)
+{
+    a->labels = grow(a->labels, &a->label_cap, a->label_count, sizeof(int));
+    a->labels[a->label_count] = -1;
+    return a->label_count++;
+}
+
+void x86_bind(X86Asm *a, int label)
+{
+    a->labels[label] = (int)a->len;
+}
+
+void x86_jmp(X86Asm *a, int label)
+{
+    x86_byte(a, 0xE9);
+    add_fixup(a, label, 0, a->len + 4);
+}
+
+void x86_jcc(X86Asm *a, X86Cond cc, int label)
+{
+    x86_byte(a, 0x0F);
+    x86_byte(a, 0x80 | cc);
+    add_fixup(a, label, 0, a->len + 4);
+}
+
+void x86_call(X86Asm *a, int label)
+{
+    x86_byte(a, 0xE8);
+    add_fixup(a, label, 0, a->len + 4);
+}
+
+void x86_push(X86Asm *a, X86Reg r)
+{
+    if (r >= 8)
+        x86_byte(a, 0x41);
+    x86_byte(a, 0x50 | (r & 7));
+}
+
+void x86_pop(X86Asm *a, X86Reg r)
+{
+    if (r >= 8)
+        x86_byte(a, 0x41);
+    x86_byte(a, 0x58 | (r & 7));
+}
+
+void x86_resolve(X86Asm *a, size_t data_offset)
+{
+    for (int i = 0; i < a->fixup_count; i++)
+    {
+        const X86Fixup *f = &a->fixups[i];
+        long target = f->label >= 0 ? a->labels[f->label] : (long)(data_offset + f->data);
+        int32_t rel = (int32_t)(target - (long)f->next);
+        for (int k = 0; k < 4; k++)
+            a->buf[f->at + k] = (uint8_t)((uint32_t)rel >> (8 * k));
+    }
+}
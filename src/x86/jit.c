@@ -0,0 +1,36 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "x86.h"
+
+// The image is position independent (rel32 calls, RIP-relative data), so
+// it runs wherever it is mapped as long as the data area stays at
+// data_offset. Code pages are flipped to R+X once copied; the data pages
+// stay R+W and come zeroed from the anonymous mapping.
+int x86_jit_run(const X86Image *image, int *status)
+{
+    size_t size = image->data_offset + image->data_size;
+    uint8_t *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+    memcpy(mem, image->code, image->code_len);
+    if (mprotect(mem, image->data_offset, PROT_READ | PROT_EXEC) != 0)
+    {
+        perror("mprotect");
+        munmap(mem, size);
+        return -1;
+    }
+
+    // The runtime writes straight to fd 1, after anything stdio still holds
+    fflush(stdout);
+    int (*entry)(void) = (int (*)(void))(mem + image->main_offset);
+    *status = entry();
+
+    munmap(mem, size);
+    return 0;
+}
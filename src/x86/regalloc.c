@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "x86.h"
+#include "opt.h"
+
+// Poletto-Sarkar linear scan. Each temporary gets one interval [lo, hi]
+// over the instructions numbered in block layout order: its defs and
+// uses, widened to the start of every block it is live into and the end
+// of every block it is live out of. rax, rdx and r11 stay free as
+// scratch registers for the instruction selector.
+
+static const X86Reg allocatable[] = {
+    RCX, RSI, RDI, R8, R9, R10, // caller-saved first: no save in the prologue
+    RBX, R12, R13, R14, R15,
+};
+
+#define REG_COUNT ((int)(sizeof(allocatable) / sizeof(allocatable[0])))
+
+static int *lo;
+static int *hi;
+
+static void extend(int t, int pos)
+{
+    if (pos < lo[t])
+        lo[t] = pos;
+    if (pos > hi[t])
+        hi[t] = pos;
+}
+
+static int temp_name(IROperand v)
+{
+    return v.kind == OPD_TEMP ? (int)v.index : -1;
+}
+
+// Every def and use, then the start of each block a temporary is live
+// into and the end of that block's predecessors
+static void build_intervals(const int *layout, int layout_count, int temps)
+{
+    int ir_count;
+    IRInstr *ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+
+    int *start = malloc(sizeof(int) * (block_count + 1));
+    int *end = malloc(sizeof(int) * (block_count + 1));
+    for (int b = 0; b < block_count; b++)
+        start[b] = -1;
+
+    int pos = 0;
+    for (int k = 0; k < layout_count; k++)
+    {
+        BasicBlock *b = cfg_get_block(layout[k]);
+        start[b->id] = pos;
+        for (int i = b->first; i < b->end; i++, pos++)
+        {
+            IROperand *ops[3];
+            int n = ir_uses(&ir[i], ops);
+            IROperand *def = ir_def(&ir[i]);
+            if (def)
+                ops[n++] = def;
+            for (int u = 0; u < n; u++)
+                if (ops[u]->kind == OPD_TEMP)
+                    extend(ops[u]->index, pos);
+        }
+        end[b->id] = pos > 0 ? pos - 1 : 0;
+    }
+
+    Liveness live;
+    liveness_build(&live, temps, temp_name);
+    for (int t = 0; t < temps; t++)
+    {
+        for (int k = live.first[t]; k < live.first[t + 1]; k++)
+        {
+            BasicBlock *block = cfg_get_block(live.blocks[k]);
+            extend(t, start[block->id]);
+            const int *preds = cfg_preds(block);
+            for (int p = 0; p < block->pred_count; p++)
+                if (start[preds[p]] >= 0)
+                    extend(t, end[preds[p]]);
+        }
+    }
+
+    liveness_free(&live);
+    free(start);
+    free(end);
+}
+
+static int by_start(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return lo[x] != lo[y] ? (lo[x] < lo[y] ? -1 : 1) : x - y;
+}
+
+X86Loc *x86_regalloc(const int *layout, int layout_count, int *frame_size,
+                     unsigned *used_regs)
+{
+    int temps = ir_temp_count();
+    X86Loc *loc = malloc(sizeof(X86Loc) * (temps + 1));
+    lo = malloc(sizeof(int) * (temps + 1));
+    hi = malloc(sizeof(int) * (temps + 1));
+    for (int t = 0; t < temps; t++)
+    {
+        lo[t] = INT_MAX;
+        hi[t] = -1;
+        loc[t] = (X86Loc){-1, 0};
+    }
+    build_intervals(layout, layout_count, temps);
+
+    int *order = malloc(sizeof(int) * (temps + 1));
+    int count = 0;
+    for (int t = 0; t < temps; t++)
+        if (hi[t] >= 0)
+            order[count++] = t;
+    qsort(order, count, sizeof(int), by_start);
+
+    // Active intervals sorted by increasing end
+    int active[REG_COUNT];
+    int active_count = 0;
+    int free_regs[REG_COUNT];
+    int free_count = REG_COUNT;
+    for (int r = 0; r < REG_COUNT; r++)
+        free_regs[r] = allocatable[REG_COUNT - 1 - r]; // popped from the back
+
+    for (int k = 0; k < count; k++)
+    {
+        int t = order[k];
+
+        int kept = 0;
+        for (int a = 0; a < active_count; a++)
+        {
+            if (hi[active[a]] < lo[t])
+                free_regs[free_count++] = loc[active[a]].reg;
+            else
+                active[kept++] = active[a];
+        }
+        active_count = kept;
+
+        int victim = t;
+        if (free_count)
+            loc[t].reg = (int8_t)free_regs[--free_count];
+        else if (hi[active[active_count - 1]] > hi[t])
+        {
+            // Spill whichever interval ends last
+            victim = active[--active_count];
+            loc[t].reg = loc[victim].reg;
+        }
+
+        if (loc[t].reg >= 0)
+        {
+            *used_regs |= 1u << loc[t].reg;
+            int a = active_count++;
+            while (a > 0 && hi[active[a - 1]] > hi[t])
+            {
+                active[a] = active[a - 1];
+                a--;
+            }
+            active[a] = t;
+        }
+        if (victim != t || loc[t].reg < 0)
+        {
+            *frame_size += 4;
+            loc[victim] = (X86Loc){-1, -*frame_size};
+        }
+    }
+
+    free(order);
+    free(lo);
+    free(hi);
+    return loc;
+}
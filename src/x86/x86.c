@@ -0,0 +1,517 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "x86.h"
+#include "semantic.h"
+
+// Instruction selection straight from the IR. Values are 32-bit words,
+// as on the QBE path. Temporaries live where x86_regalloc puts them;
+// variables still in memory (-O0, or anything SSA left behind) get a
+// stack slot. rax, rdx and r11 are scratch.
+
+// Data area: the output buffer and its fill level
+#define OUT_BUF 0
+#define OUT_BUF_SIZE 4096
+#define OUT_LEN OUT_BUF_SIZE
+#define DATA_SIZE (OUT_BUF_SIZE + 4)
+
+static X86Asm a;
+static IRInstr *ir;
+static X86Loc *loc;
+static int32_t *var_disp; // stack slot per variable, 0 if none
+static int *use_count;    // per temporary
+static int *block_label;
+static int print_label, flush_label;
+
+static const X86Reg callee_saved[] = {RBX, R12, R13, R14, R15};
+
+/* ---------- Operands ---------- */
+
+static int has_slot(IROperand v)
+{
+    return v.kind == OPD_VAR && var_disp[v.index] != 0;
+}
+
+// Strings have no value yet and read as 0, as on the QBE path
+static int is_string(IROperand v)
+{
+    return v.kind == OPD_STR || (v.kind == OPD_VAR && !has_slot(v));
+}
+
+static int is_imm(IROperand v)
+{
+    return v.kind == OPD_INT || v.kind == OPD_CONST || is_string(v);
+}
+
+static int32_t imm_value(IROperand v)
+{
+    if (v.kind == OPD_INT)
+        return v.imm;
+    if (is_string(v))
+        return 0;
+    // Every value is a word, so wide and fractional constants truncate
+    const IRConst *c = ir_const(v.index);
+    return (int32_t)(c->is_double ? (int64_t)c->d : c->i);
+}
+
+// Register or stack slot holding a temporary or variable
+static X86Rm rm_of(IROperand v)
+{
+    if (v.kind == OPD_TEMP)
+    {
+        X86Loc l = loc[v.index];
+        return l.reg >= 0 ? x86_reg(l.reg) : x86_mem(RBP, l.disp);
+    }
+    return x86_mem(RBP, var_disp[v.index]);
+}
+
+static int in_reg(IROperand v, X86Reg r)
+{
+    return v.kind == OPD_TEMP && loc[v.index].reg == (int8_t)r;
+}
+
+static void mov_imm(X86Reg r, int32_t v)
+{
+    if (r >= 8)
+        x86_byte(&a, 0x41);
+    x86_byte(&a, 0xB8 | (r & 7));
+    x86_imm32(&a, v);
+}
+
+static void load(X86Reg r, IROperand v)
+{
+    if (is_imm(v))
+        mov_imm(r, imm_value(v));
+    else if (!in_reg(v, r))
+        x86_modrm(&a, 32, "\x8b", r, rm_of(v), 0);
+}
+
+static void store(IROperand dst, X86Reg r)
+{
+    if (!in_reg(dst, r))
+        x86_modrm(&a, 32, "\x89", r, rm_of(dst), 0);
+}
+
+// r = r <op> v for add (/0, 03), sub (/5, 2B) and cmp (/7, 3B)
+static void alu(int ext, const char *opcode, X86Reg r, IROperand v)
+{
+    if (is_imm(v))
+    {
+        x86_modrm(&a, 32, "\x81", ext, x86_reg(r), 4);
+        x86_imm32(&a, imm_value(v));
+    }
+    else
+        x86_modrm(&a, 32, opcode, r, rm_of(v), 0);
+}
+
+/* ---------- Instructions ---------- */
+
+static int setcc_code(int op)
+{
+    switch (op)
+    {
+    case IR_EQ: return CC_E;
+    case IR_NE: return CC_NE;
+    case IR_LT: return CC_L;
+    case IR_GT: return CC_G;
+    case IR_LE: return CC_LE;
+    default: return CC_GE;
+    }
+}
+
+static int is_compare(int op)
+{
+    return op >= IR_EQ && op <= IR_GE;
+}
+
+static void emit_binary(const IRInstr *in)
+{
+    if (in->op == IR_DIV)
+    {
+        load(RAX, in->lhs);
+        x86_byte(&a, 0x99); // cdq
+        if (is_imm(in->rhs))
+        {
+            mov_imm(R11, imm_value(in->rhs));
+            x86_modrm(&a, 32, "\xf7", 7, x86_reg(R11), 0);
+        }
+        else
+            x86_modrm(&a, 32, "\xf7", 7, rm_of(in->rhs), 0);
+        store(in->dst, RAX);
+        return;
+    }
+
+    if (is_compare(in->op))
+    {
+        load(RAX, in->lhs);
+        alu(7, "\x3b", RAX, in->rhs);
+        x86_modrm(&a, 8, (char[]){0x0F, (char)(0x90 | setcc_code(in->op)), 0}, 0, x86_reg(RAX), 0);
+        x86_modrm(&a, 32, "\x0f\xb6", RAX, x86_reg(RAX), 0);
+        store(in->dst, RAX);
+        return;
+    }
+
+    // Work in the destination register unless the right operand lives there
+    X86Loc d = loc[in->dst.index];
+    X86Reg work = d.reg >= 0 && !in_reg(in->rhs, d.reg) ? (X86Reg)d.reg : RAX;
+    load(work, in->lhs);
+    switch (in->op)
+    {
+    case IR_ADD:
+        alu(0, "\x03", work, in->rhs);
+        break;
+    case IR_SUB:
+        alu(5, "\x2b", work, in->rhs);
+        break;
+    default: // IR_MUL
+        if (is_imm(in->rhs))
+        {
+            x86_modrm(&a, 32, "\x69", work, x86_reg(work), 4);
+            x86_imm32(&a, imm_value(in->rhs));
+        }
+        else
+            x86_modrm(&a, 32, "\x0f\xaf", work, rm_of(in->rhs), 0);
+        break;
+    }
+    store(in->dst, work);
+}
+
+static void emit_assign(const IRInstr *in)
+{
+    if (in->dst.kind == OPD_VAR && !has_slot(in->dst))
+        return; // strings have no representation yet
+    if (in->lhs.kind == OPD_VAR && !has_slot(in->lhs))
+        return;
+    if (in->lhs.kind == OPD_STR || in->lhs.kind == OPD_NONE)
+        return;
+
+    X86Rm dst = rm_of(in->dst);
+    if (is_imm(in->lhs))
+    {
+        if (dst.kind == X86_RM_REG)
+            mov_imm(dst.reg, imm_value(in->lhs));
+        else
+        {
+            x86_modrm(&a, 32, "\xc7", 0, dst, 4);
+            x86_imm32(&a, imm_value(in->lhs));
+        }
+    }
+    else if (dst.kind == X86_RM_REG)
+        load(dst.reg, in->lhs);
+    else
+    {
+        load(RAX, in->lhs);
+        store(in->dst, RAX);
+    }
+}
+
+static void emit_epilogue(unsigned saved)
+{
+    x86_call(&a, flush_label);
+    for (int k = 4; k >= 0; k--)
+        if (saved & 1u << callee_saved[k])
+            x86_pop(&a, callee_saved[k]);
+    x86_modrm(&a, 32, "\x31", RAX, x86_reg(RAX), 0); // xor eax, eax
+    x86_byte(&a, 0xC9);                               // leave
+    x86_byte(&a, 0xC3);                               // ret
+}
+
+static void emit_instr(int i, unsigned saved)
+{
+    IRInstr *in = &ir[i];
+
+    if (IR_IS_BINARY(in->op))
+        emit_binary(in);
+    else if (in->op == IR_ASSIGN)
+        emit_assign(in);
+    else if (in->op == IR_RET)
+        emit_epilogue(saved);
+    else if (in->op == IR_CALL && in->callee == CALLEE_CONSOLE_LOG && i > 0)
+    {
+        IROperand arg = ir[i - 1].lhs;
+        if (arg.kind != OPD_NONE && !is_string(arg))
+        {
+            load(RAX, arg);
+            x86_call(&a, print_label);
+        }
+    }
+    // Labels, params, nops and jumps: see emit_block
+}
+
+/* ---------- Blocks ---------- */
+
+// Compare feeding only the branch that ends its block: emitted as
+// cmp + jcc at the branch instead of setcc + test
+static int fused_compare(const BasicBlock *b, int i)
+{
+    const IRInstr *last = &ir[b->end - 1];
+    if (!is_compare(ir[i].op) || b->succ_count != 2 || last->op != IR_IF_FALSE ||
+        last->lhs.kind != OPD_TEMP || last->lhs.index != ir[i].dst.index ||
+        use_count[ir[i].dst.index] != 1)
+        return 0;
+    for (int k = i + 1; k < b->end - 1; k++)
+        if (ir[k].op != IR_NOP)
+            return 0;
+    return 1;
+}
+
+static const int inverse_cc[] = {
+    [CC_E] = CC_NE, [CC_NE] = CC_E, [CC_L] = CC_GE,
+    [CC_GE] = CC_L, [CC_LE] = CC_G, [CC_G] = CC_LE,
+};
+
+static void emit_block(const BasicBlock *b, int next, unsigned saved)
+{
+    x86_bind(&a, block_label[b->id]);
+
+    int fused = -1;
+    for (int i = b->first; i < b->end; i++)
+    {
+        if (fused_compare(b, i))
+            fused = i;
+        else
+            emit_instr(i, saved);
+    }
+
+    const int *succ = cfg_succs(b);
+    const IRInstr *last = b->end > b->first ? &ir[b->end - 1] : NULL;
+    if (last && last->op == IR_IF_FALSE && b->succ_count == 2)
+    {
+        if (fused >= 0)
+        {
+            load(RAX, ir[fused].lhs);
+            alu(7, "\x3b", RAX, ir[fused].rhs);
+            x86_jcc(&a, inverse_cc[setcc_code(ir[fused].op)], block_label[succ[1]]);
+        }
+        else if (is_imm(last->lhs))
+        {
+            if (imm_value(last->lhs) == 0)
+                x86_jmp(&a, block_label[succ[1]]);
+        }
+        else
+        {
+            X86Rm cond = rm_of(last->lhs);
+            if (cond.kind == X86_RM_REG)
+                x86_modrm(&a, 32, "\x85", cond.reg, cond, 0); // test r, r
+            else
+            {
+                x86_modrm(&a, 32, "\x81", 7, cond, 4); // cmp [slot], 0
+                x86_imm32(&a, 0);
+            }
+            x86_jcc(&a, CC_E, block_label[succ[1]]);
+        }
+        if (succ[0] != next)
+            x86_jmp(&a, block_label[succ[0]]);
+    }
+    else if (b->succ_count == 1 && succ[0] != next)
+        x86_jmp(&a, block_label[succ[0]]);
+}
+
+/* ---------- Runtime ---------- */
+
+static X86Reg const runtime_saved[] = {RCX, RDX, RSI, RDI, R8, R11};
+#define RUNTIME_SAVED 6
+
+// print_int: eax -> decimal line in the output buffer. Preserves every
+// register but rax, so calls need no caller-side saves.
+static void emit_print_int(void)
+{
+    int positive = x86_new_label(&a), digit = x86_new_label(&a);
+    int unsigned_done = x86_new_label(&a), room = x86_new_label(&a);
+    int copy = x86_new_label(&a);
+
+    x86_bind(&a, print_label);
+    for (int k = 0; k < RUNTIME_SAVED; k++)
+        x86_push(&a, runtime_saved[k]);
+    x86_modrm(&a, 64, "\x81", 5, x86_reg(RSP), 4); // sub rsp, 32
+    x86_imm32(&a, 32);
+
+    // Digits go backwards into [rsp, rsp + 32)
+    x86_modrm(&a, 64, "\x63", RAX, x86_reg(RAX), 0); // movsxd rax, eax
+    x86_modrm(&a, 32, "\x31", R8, x86_reg(R8), 0);   // r8d = negative
+    x86_modrm(&a, 64, "\x85", RAX, x86_reg(RAX), 0);
+    x86_jcc(&a, CC_NS, positive);
+    x86_modrm(&a, 64, "\xf7", 3, x86_reg(RAX), 0); // neg rax
+    mov_imm(R8, 1);
+    x86_bind(&a, positive);
+    x86_modrm(&a, 64, "\x8d", RSI, x86_mem(RSP, 32), 0); // lea rsi, [rsp + 32]
+    mov_imm(RCX, 10);
+    x86_bind(&a, digit);
+    x86_modrm(&a, 32, "\x31", RDX, x86_reg(RDX), 0); // xor edx, edx
+    x86_modrm(&a, 64, "\xf7", 6, x86_reg(RCX), 0);   // div rcx
+    x86_modrm(&a, 8, "\x80", 0, x86_reg(RDX), 1);    // add dl, '0'
+    x86_byte(&a, '0');
+    x86_modrm(&a, 64, "\xff", 1, x86_reg(RSI), 0);   // dec rsi
+    x86_modrm(&a, 8, "\x88", RDX, x86_mem(RSI, 0), 0);
+    x86_modrm(&a, 64, "\x85", RAX, x86_reg(RAX), 0);
+    x86_jcc(&a, CC_NE, digit);
+    x86_modrm(&a, 32, "\x85", R8, x86_reg(R8), 0);
+    x86_jcc(&a, CC_E, unsigned_done);
+    x86_modrm(&a, 64, "\xff", 1, x86_reg(RSI), 0);
+    x86_modrm(&a, 8, "\xc6", 0, x86_mem(RSI, 0), 1); // mov byte [rsi], '-'
+    x86_byte(&a, '-');
+    x86_bind(&a, unsigned_done);
+
+    // Flush first unless a full line (at most 12 bytes) still fits
+    x86_modrm(&a, 32, "\x8b", RAX, x86_data(OUT_LEN), 0);
+    x86_modrm(&a, 32, "\x81", 7, x86_reg(RAX), 4);
+    x86_imm32(&a, OUT_BUF_SIZE - 16);
+    x86_jcc(&a, CC_LE, room);
+    x86_call(&a, flush_label);
+    x86_bind(&a, room);
+
+    x86_modrm(&a, 32, "\x8b", RAX, x86_data(OUT_LEN), 0);
+    x86_modrm(&a, 64, "\x8d", RDI, x86_data(OUT_BUF), 0);
+    x86_modrm(&a, 64, "\x01", RAX, x86_reg(RDI), 0);     // add rdi, rax
+    x86_modrm(&a, 64, "\x8d", RDX, x86_mem(RSP, 32), 0); // end of digits
+    x86_bind(&a, copy);
+    x86_modrm(&a, 8, "\x8a", RCX, x86_mem(RSI, 0), 0);
+    x86_modrm(&a, 8, "\x88", RCX, x86_mem(RDI, 0), 0);
+    x86_modrm(&a, 64, "\xff", 0, x86_reg(RSI), 0);
+    x86_modrm(&a, 64, "\xff", 0, x86_reg(RDI), 0);
+    x86_modrm(&a, 64, "\x39", RDX, x86_reg(RSI), 0); // cmp rsi, rdx
+    x86_jcc(&a, CC_NE, copy);
+    x86_modrm(&a, 8, "\xc6", 0, x86_mem(RDI, 0), 1);
+    x86_byte(&a, '\n');
+    x86_modrm(&a, 64, "\xff", 0, x86_reg(RDI), 0);
+    x86_modrm(&a, 64, "\x8d", RAX, x86_data(OUT_BUF), 0);
+    x86_modrm(&a, 64, "\x29", RAX, x86_reg(RDI), 0); // sub rdi, rax
+    x86_modrm(&a, 32, "\x89", RDI, x86_data(OUT_LEN), 0);
+
+    x86_modrm(&a, 64, "\x81", 0, x86_reg(RSP), 4); // add rsp, 32
+    x86_imm32(&a, 32);
+    for (int k = RUNTIME_SAVED - 1; k >= 0; k--)
+        x86_pop(&a, runtime_saved[k]);
+    x86_byte(&a, 0xC3);
+}
+
+// flush: write(1, buffer, length) until done, then empty the buffer
+static void emit_flush(void)
+{
+    int loop = x86_new_label(&a), done = x86_new_label(&a);
+
+    x86_bind(&a, flush_label);
+    x86_push(&a, RAX);
+    for (int k = 0; k < RUNTIME_SAVED; k++)
+        x86_push(&a, runtime_saved[k]);
+    x86_modrm(&a, 32, "\x8b", RDX, x86_data(OUT_LEN), 0);
+    x86_modrm(&a, 64, "\x8d", RSI, x86_data(OUT_BUF), 0);
+    x86_bind(&a, loop);
+    x86_modrm(&a, 64, "\x85", RDX, x86_reg(RDX), 0);
+    x86_jcc(&a, CC_LE, done);
+    mov_imm(RAX, 1); // SYS_write
+    mov_imm(RDI, 1);
+    x86_byte(&a, 0x0F);
+    x86_byte(&a, 0x05); // syscall
+    x86_modrm(&a, 64, "\x85", RAX, x86_reg(RAX), 0);
+    x86_jcc(&a, CC_LE, done); // error: drop the rest
+    x86_modrm(&a, 64, "\x01", RAX, x86_reg(RSI), 0); // add rsi, rax
+    x86_modrm(&a, 64, "\x29", RAX, x86_reg(RDX), 0); // sub rdx, rax
+    x86_jmp(&a, loop);
+    x86_bind(&a, done);
+    x86_modrm(&a, 32, "\xc7", 0, x86_data(OUT_LEN), 4);
+    x86_imm32(&a, 0);
+    for (int k = RUNTIME_SAVED - 1; k >= 0; k--)
+        x86_pop(&a, runtime_saved[k]);
+    x86_pop(&a, RAX);
+    x86_byte(&a, 0xC3);
+}
+
+/* ---------- Driver ---------- */
+
+void x86_codegen(X86Image *image)
+{
+    int ir_count;
+    ir = ir_get_all(&ir_count);
+    int block_count = cfg_block_count();
+
+    // Reachable blocks keep their order, as on the QBE path
+    int *layout = malloc(sizeof(int) * (block_count + 1));
+    int layout_count = 0;
+    for (int b = 0; b < block_count; b++)
+        if (cfg_get_block(b)->rpo >= 0)
+            layout[layout_count++] = b;
+
+    // Stack slots for variables still in memory (strings have none)
+    int frame = 0;
+    var_disp = calloc(semantic_symbol_count() + 1, sizeof(int32_t));
+    use_count = calloc(ir_temp_count() + 1, sizeof(int));
+    for (int i = 0; i < ir_count; i++)
+    {
+        IROperand *ops[3];
+        int n = ir_uses(&ir[i], ops);
+        for (int u = 0; u < n; u++)
+            if (ops[u]->kind == OPD_TEMP)
+                use_count[ops[u]->index]++;
+        IROperand *def = ir_def(&ir[i]);
+        if (def)
+            ops[n++] = def;
+        for (int u = 0; u < n; u++)
+        {
+            SymbolId var = ops[u]->index;
+            if (ops[u]->kind == OPD_VAR && var && !var_disp[var] &&
+                semantic_symbol(var)->type != TYPE_STRING)
+            {
+                frame += 4;
+                var_disp[var] = -frame;
+            }
+        }
+    }
+
+    unsigned used = 0;
+    loc = x86_regalloc(layout, layout_count, &frame, &used);
+    frame = (frame + 15) & ~15;
+    unsigned saved = used & (1u << RBX | 1u << R12 | 1u << R13 | 1u << R14 | 1u << R15);
+
+    x86_asm_init(&a);
+    print_label = x86_new_label(&a);
+    flush_label = x86_new_label(&a);
+    emit_print_int();
+    emit_flush();
+
+    // main: rbp frame, then the callee-saved registers the allocator used
+    block_label = malloc(sizeof(int) * (block_count + 1));
+    for (int b = 0; b < block_count; b++)
+        block_label[b] = x86_new_label(&a);
+    image->main_offset = a.len;
+    x86_push(&a, RBP);
+    x86_modrm(&a, 64, "\x89", RSP, x86_reg(RBP), 0); // mov rbp, rsp
+    x86_modrm(&a, 64, "\x81", 5, x86_reg(RSP), 4);  // sub rsp, frame
+    x86_imm32(&a, frame);
+    for (int k = 0; k < 5; k++)
+        if (saved & 1u << callee_saved[k])
+            x86_push(&a, callee_saved[k]);
+
+    for (int k = 0; k < layout_count; k++)
+        emit_block(cfg_get_block(layout[k]), k + 1 < layout_count ? layout[k + 1] : -1, saved);
+
+    // _start: exit(main())
+    int main_label = x86_new_label(&a);
+    a.labels[main_label] = (int)image->main_offset;
+    image->start_offset = a.len;
+    x86_call(&a, main_label);
+    x86_modrm(&a, 32, "\x89", RAX, x86_reg(RDI), 0); // mov edi, eax
+    mov_imm(RAX, 60);                                // SYS_exit
+    x86_byte(&a, 0x0F);
+    x86_byte(&a, 0x05);
+
+    image->data_offset = (a.len + 4095) & ~(size_t)4095;
+    image->data_size = DATA_SIZE;
+    x86_resolve(&a, image->data_offset);
+    image->code = a.buf;
+    image->code_len = a.len;
+    a.buf = NULL;
+
+    x86_asm_free(&a);
+    free(layout);
+    free(var_disp);
+    free(use_count);
+    free(block_label);
+    free(loc);
+}
+
+void x86_free(X86Image *image)
+{
+    free(image->code);
+    memset(image, 0, sizeof(*image));
+}
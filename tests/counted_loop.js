@@ -0,0 +1,32 @@
+// Counted loops (C backend: const bound local) next to ones that are not
+const n = 6;
+let s = 0;
+for (let i = 0; i < n; i++) {
+    s = s + i;
+}
+console.log(s);
+let t = 0;
+for (let j = 10; j > 0; j--) {
+    t = t + j * 2;
+}
+console.log(t);
+let m = 20;
+let u = 0;
+for (let k = 0; k < m; k++) {
+    m = m - 1;
+    u = u + 1;
+}
+console.log(u);
+let w = 0;
+for (let a = 0; a < 3; a++) {
+    for (let b = 0; b <= a; b++) {
+        w = w + b;
+    }
+}
+console.log(w);
+let c = 0;
+let x = 0;
+for (x = 0; x < x; x++) {
+    c = c + 100;
+}
+console.log(c);
@@ -0,0 +1,13 @@
+// Dead header phis left as NOPs must not shift the ones unrolling rewrites
+let i = 0;
+let a = 0;
+let k = 5;
+let b = 0;
+for (i = 0; i < 3; i++) {
+    a = a + 1;
+    k = 5;
+    b = b + 2;
+}
+console.log(a);
+console.log(k);
+console.log(b);
@@ -0,0 +1,8 @@
+// Renames from one unrolled loop must not leak into the next
+let i = 0;
+for (i = 0; i < 3; i++) {
+}
+for (let j = 0; j < 3; j++) {
+    console.log(i);
+}
+console.log(i);
@@ -0,0 +1,133 @@
+// Scaling benchmark for the compiler front half.
+//
+// Generates JS programs of 1K, 10K, 100K and 1M lines, compiles each with
+// `jscc <file> -q` (stopping after QBE IR is written) and reports wall
+// time and peak RSS. If the pipeline is linear, the per-line columns stay
+// flat as the input grows by 10x.
+//
+// Usage: bench_scale [path/to/jscc] [max_lines]
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+// One chunk of generated code; every variable is block scoped so the
+// symbol tables never hold more than a few names
+static const char *chunk =
+    "if (1 < 2) {\n"
+    "    let a = 7 * 6;\n"
+    "    let b = 0x1F;\n"
+    "    a = 40 + 2;\n"
+    "    console.log(a);\n"
+    "}\n"
+    "while (0 < 0) {\n"
+    "    let c = 3 - 1;\n"
+    "    console.log(5);\n"
+    "}\n"
+    "for (let i = 0; i < 3; i++) {\n"
+    "    console.log(i);\n"
+    "}\n"
+    "// comment line\n"
+    "let s = \"text\";\n";
+
+#define CHUNK_LINES 15
+
+static long write_program(const char *path, long lines)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    // Top-level names repeat per chunk, so give each chunk its own block
+    long written = 0;
+    while (written + CHUNK_LINES + 2 <= lines || written == 0)
+    {
+        fputs("if (1 < 2) {\n", f);
+        fputs(chunk, f);
+        fputs("}\n", f);
+        written += CHUNK_LINES + 2;
+    }
+    fclose(f);
+    return written;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Run jscc on path; returns 0 on success and fills seconds / peak KB
+static int run(const char *jscc, const char *path, double *seconds, long *max_kb)
+{
+    double start = now();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0)
+            dup2(null, STDOUT_FILENO);
+        execl(jscc, jscc, path, "-q", (char *)NULL);
+        perror(jscc);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        perror("wait4");
+        exit(1);
+    }
+    *seconds = now() - start;
+    *max_kb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *jscc = argc > 1 ? argv[1] : "./jscc";
+    long max_lines = argc > 2 ? atol(argv[2]) : 1000000;
+
+    mkdir("tmp", 0755);
+
+    printf("%10s %10s %12s %10s %12s\n", "lines", "seconds", "us/line", "peak MB", "bytes/line");
+    for (long target = 1000; target <= max_lines; target *= 10)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "tmp/bench_%ld.js", target);
+        long lines = write_program(path, target);
+
+        double seconds;
+        long max_kb;
+        if (run(jscc, path, &seconds, &max_kb) != 0)
+        {
+            fprintf(stderr, "bench_scale: %s failed on %s\n", jscc, path);
+            return 1;
+        }
+
+        printf("%10ld %10.3f %12.3f %10.1f %12.1f\n", lines, seconds,
+               seconds * 1e6 / lines, max_kb / 1024.0, max_kb * 1024.0 / lines);
+        remove(path);
+    }
+    return 0;
+}